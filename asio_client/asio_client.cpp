@@ -29,6 +29,8 @@
 //use your own code to replace the following all_out_helper2 macros, then you can record logs according to your wishes.
 //custom log should be defined(or included) before including any st_asio_wrapper header files except st_asio_wrapper_base.h
 //notice: please don't forget to define the ST_ASIO_CUSTOM_LOG macro.
+//if you just want to output logs asynchronously (without stalling service threads), include ext/st_asio_wrapper_async_log.h instead,
+//it defines ST_ASIO_CUSTOM_LOG and unified_out, and must be included before any other st_asio_wrapper header files.
 #include "../include/st_asio_wrapper_base.h"
 using namespace st_asio_wrapper;
 
@@ -18,6 +18,7 @@
 //1-default replaceable_packer and replaceable_unpacker, head(length) + body
 //2-fixed length unpacker
 //3-prefix and suffix packer and unpacker
+//4-slab_packer and slab_unpacker, head(length) + body, packing and unpacking msgs without memory allocation and replication
 
 #if 1 == PACKER_UNPACKER_TYPE
 #define ST_ASIO_DEFAULT_PACKER replaceable_packer<>
@@ -28,6 +29,9 @@
 #elif 3 == PACKER_UNPACKER_TYPE
 #define ST_ASIO_DEFAULT_PACKER prefix_suffix_packer
 #define ST_ASIO_DEFAULT_UNPACKER prefix_suffix_unpacker
+#elif 4 == PACKER_UNPACKER_TYPE
+#define ST_ASIO_DEFAULT_PACKER slab_packer
+#define ST_ASIO_DEFAULT_UNPACKER slab_unpacker
 #endif
 //configuration
 
@@ -0,0 +1,278 @@
+/*
+ * st_asio_wrapper_async_log.h
+ *
+ *  Created on: 2026-10-18
+ *
+ * asynchronous log backend for unified_out.
+ * include this file before any other st_asio_wrapper header files, it will define ST_ASIO_CUSTOM_LOG and class unified_out.
+ */
+
+#ifndef ST_ASIO_WRAPPER_ASYNC_LOG_H_
+#define ST_ASIO_WRAPPER_ASYNC_LOG_H_
+
+#if defined(ST_ASIO_WRAPPER_BASE_H_) && !defined(ST_ASIO_CUSTOM_LOG)
+	#error st_asio_wrapper_async_log.h must be included before any other st_asio_wrapper header files.
+#endif
+
+#ifndef ST_ASIO_CUSTOM_LOG
+#define ST_ASIO_CUSTOM_LOG
+#endif
+
+#include <vector>
+#include <algorithm>
+
+#include "../st_asio_wrapper_base.h"
+
+//every thread which outputs logs has a ring with ST_ASIO_ASYNC_LOG_LINE_NUM lines, each line can hold ST_ASIO_ASYNC_LOG_LINE_SIZE bytes (longer logs will be truncated),
+//if the ring is full (the background thread cannot catch up), new logs will be dropped rather than blocking the caller, and the number of dropped logs will be reported.
+//the ring will be freed after its owner thread exited and all of its logs been flushed.
+#ifndef ST_ASIO_ASYNC_LOG_LINE_SIZE
+#define ST_ASIO_ASYNC_LOG_LINE_SIZE		512
+#endif
+static_assert(ST_ASIO_ASYNC_LOG_LINE_SIZE > 0, "async log line size must be bigger than zero.");
+
+#ifndef ST_ASIO_ASYNC_LOG_LINE_NUM
+#define ST_ASIO_ASYNC_LOG_LINE_NUM		256
+#endif
+static_assert(ST_ASIO_ASYNC_LOG_LINE_NUM > 0, "async log line number must be bigger than zero.");
+
+//the background thread flushes logs every ST_ASIO_ASYNC_LOG_FLUSH_INTERVAL milliseconds, fatal logs will wake it up immediately.
+#ifndef ST_ASIO_ASYNC_LOG_FLUSH_INTERVAL
+#define ST_ASIO_ASYNC_LOG_FLUSH_INTERVAL	100
+#endif
+static_assert(ST_ASIO_ASYNC_LOG_FLUSH_INTERVAL > 0, "async log flush interval must be bigger than zero.");
+
+//logs whose level is lower than ST_ASIO_LOG_LEVEL will be removed at compile time (see async_log::log_level for all levels),
+//the level can also be raised at runtime via async_log::level().
+#ifndef ST_ASIO_LOG_LEVEL
+#define ST_ASIO_LOG_LEVEL	0 //LOG_DEBUG
+#endif
+
+namespace st_asio_wrapper { namespace ext {
+
+//logs are formatted (vsnprintf) into the caller's own ring (single producer single consumer, lock-free), without any memory allocations,
+//and written to the output file by a background thread, in the order of their arrival (across all threads), timestamps are formatted
+//by the background thread too, and only once per second.
+class async_log
+{
+public:
+	enum log_level {LOG_DEBUG, LOG_INFO, LOG_WARNING, LOG_ERROR, LOG_FATAL};
+
+	//the background thread is started at the first use, and stopped (with all logs flushed) when the program exits.
+	static async_log& instance() {static async_log log_; return log_;}
+
+	void level(log_level level_) {cur_level = level_;}
+	log_level level() const {return (log_level) (size_t) cur_level;}
+
+	//stdout by default, the file will not be closed by async_log.
+	void output(FILE* file_) {boost::unique_lock<boost::mutex> lock(flush_mutex); file = file_;}
+
+	uint_fast64_t dropped_num() const {return dropped;}
+
+	void log(log_level level_, const char* fmt, va_list& ap)
+	{
+		if ((size_t) level_ < (size_t) cur_level)
+			return;
+
+		auto r = get_ring();
+		size_t tail = r->tail;
+		if (tail - r->head >= ST_ASIO_ASYNC_LOG_LINE_NUM)
+		{
+			++dropped;
+			return;
+		}
+
+		auto& l = r->lines[tail % ST_ASIO_ASYNC_LOG_LINE_NUM];
+		l.seq = ++seq;
+		l.time = time(nullptr);
+		l.level = level_;
+#if BOOST_WORKAROUND(BOOST_MSVC, >= 1400) && !defined(UNDER_CE)
+		vsnprintf_s(l.content, sizeof(l.content), _TRUNCATE, fmt, ap);
+#else
+		vsnprintf(l.content, sizeof(l.content), fmt, ap);
+#endif
+		r->tail = tail + 1; //publish this line to the background thread
+
+		if (LOG_FATAL == level_)
+			flush_cond.notify_one();
+	}
+
+	//write all logs to the output file synchronously.
+	void flush() {boost::unique_lock<boost::mutex> lock(flush_mutex); do_flush();}
+
+private:
+	struct line
+	{
+		uint_fast64_t seq;
+		time_t time;
+		log_level level;
+		char content[ST_ASIO_ASYNC_LOG_LINE_SIZE];
+	};
+
+	//written by its owner thread, read by the background thread
+	struct ring
+	{
+		ring() : head(0), tail(0), dead(0) {}
+
+		st_atomic_size_t head; //only the background thread changes it
+		st_atomic_size_t tail; //only the owner thread changes it
+		st_atomic_size_t dead; //the owner thread exited, tail will never change again
+		line lines[ST_ASIO_ASYNC_LOG_LINE_NUM];
+	};
+
+	async_log() : cur_level((size_t) LOG_DEBUG), dropped(0), seq(0), file(stdout), last_time(0), reported_dropped(0), stopped(false),
+		local_ring(&async_log::release_ring), flush_thread([this]() {ST_THIS flush_loop();}) {}
+	~async_log()
+	{
+		boost::unique_lock<boost::mutex> lock(cond_mutex);
+		stopped = true;
+		lock.unlock();
+
+		flush_cond.notify_one();
+		flush_thread.join();
+		flush();
+	}
+
+	//rings are owned by async_log (see ring_can), because the background thread may still need them after their owner threads exited,
+	//so just mark the ring as dead here, do_flush will free it after flushed all of its logs.
+	static void release_ring(ring* r) {r->dead = 1;}
+
+	ring* get_ring()
+	{
+		auto r = local_ring.get();
+		if (nullptr == r)
+		{
+			auto new_ring = boost::make_shared<ring>();
+			boost::unique_lock<boost::shared_mutex> lock(ring_can_mutex);
+			ring_can.push_back(new_ring);
+			lock.unlock();
+
+			local_ring.reset(r = new_ring.get());
+		}
+
+		return r;
+	}
+
+	void flush_loop()
+	{
+		boost::unique_lock<boost::mutex> lock(cond_mutex);
+		while (!stopped)
+		{
+			flush_cond.timed_wait(lock, boost::posix_time::milliseconds(ST_ASIO_ASYNC_LOG_FLUSH_INTERVAL));
+			lock.unlock();
+			flush();
+			lock.lock();
+		}
+	}
+
+	const char* format_time(time_t now)
+	{
+		if (now != last_time)
+		{
+			last_time = now;
+#ifdef _MSC_VER
+			ctime_s(time_buff, sizeof(time_buff), &now);
+#else
+			ctime_r(&now, time_buff);
+#endif
+			auto len = strlen(time_buff);
+			if (len > 0 && '\n' == time_buff[len - 1])
+				time_buff[len - 1] = '\0';
+		}
+
+		return time_buff;
+	}
+
+	//flush_mutex must be locked
+	void do_flush()
+	{
+		static const char* const level_names[] = {"debug", "info", "warning", "error", "fatal"};
+
+		line_can.clear();
+		tail_can.clear();
+		boost::shared_lock<boost::shared_mutex> lock(ring_can_mutex);
+		for (auto iter = std::begin(ring_can); iter != std::end(ring_can); ++iter)
+		{
+			size_t tail = (*iter)->tail;
+			for (size_t i = (*iter)->head; i != tail; ++i)
+				line_can.push_back(&(*iter)->lines[i % ST_ASIO_ASYNC_LOG_LINE_NUM]);
+			tail_can.push_back(tail);
+		}
+
+		std::sort(std::begin(line_can), std::end(line_can), [](const line* l1, const line* l2) {return l1->seq < l2->seq;});
+		for (auto iter = std::begin(line_can); iter != std::end(line_can); ++iter)
+			fprintf(file, "[%s] %s -> %s\n", level_names[(*iter)->level], format_time((*iter)->time), (*iter)->content);
+
+		auto has_dead = false;
+		auto tail_iter = std::begin(tail_can);
+		for (auto iter = std::begin(ring_can); iter != std::end(ring_can); ++iter, ++tail_iter)
+		{
+			(*iter)->head = *tail_iter; //release these lines to their owner threads
+			has_dead = has_dead || 0 != (*iter)->dead;
+		}
+		lock.unlock();
+
+		if (has_dead)
+		{
+			boost::unique_lock<boost::shared_mutex> lock(ring_can_mutex);
+			//check dead before tail, after the owner thread exited, tail will never change again
+			ring_can.remove_if([](const boost::shared_ptr<ring>& item) {return 0 != item->dead && item->head == item->tail;});
+		}
+
+		uint_fast64_t dropped_ = dropped;
+		if (dropped_ != reported_dropped)
+		{
+			fprintf(file, "[warning] %s -> " ST_ASIO_SF " logs have been dropped because of ring overflow.\n", format_time(time(nullptr)), (size_t) (dropped_ - reported_dropped));
+			reported_dropped = dropped_;
+		}
+
+		if (!line_can.empty())
+			fflush(file);
+	}
+
+private:
+	st_atomic_size_t cur_level;
+	st_atomic_uint_fast64 dropped;
+	st_atomic_uint_fast64 seq;
+
+	//used by the background thread (or flush()), protected by flush_mutex
+	FILE* file;
+	std::vector<const line*> line_can;
+	std::vector<size_t> tail_can;
+	time_t last_time;
+	char time_buff[64];
+	uint_fast64_t reported_dropped;
+	boost::mutex flush_mutex;
+
+	boost::container::list<boost::shared_ptr<ring>> ring_can;
+	boost::shared_mutex ring_can_mutex;
+
+	bool stopped;
+	boost::mutex cond_mutex;
+	boost::condition_variable flush_cond;
+
+	boost::thread_specific_ptr<ring> local_ring;
+	boost::thread flush_thread; //must be the last member, because it uses all other members
+};
+
+}} //namespace
+
+namespace st_asio_wrapper
+{
+
+#define async_log_helper(level) \
+if (level >= ST_ASIO_LOG_LEVEL) {va_list ap; va_start(ap, fmt); ext::async_log::instance().log(level, fmt, ap); va_end(ap);}
+
+class unified_out
+{
+public:
+	static void fatal_out(const char* fmt, ...) {async_log_helper(ext::async_log::LOG_FATAL);}
+	static void error_out(const char* fmt, ...) {async_log_helper(ext::async_log::LOG_ERROR);}
+	static void warning_out(const char* fmt, ...) {async_log_helper(ext::async_log::LOG_WARNING);}
+	static void info_out(const char* fmt, ...) {async_log_helper(ext::async_log::LOG_INFO);}
+	static void debug_out(const char* fmt, ...) {async_log_helper(ext::async_log::LOG_DEBUG);}
+};
+
+} //namespace
+
+#endif /* ST_ASIO_WRAPPER_ASYNC_LOG_H_ */
@@ -17,6 +17,42 @@
 
 #include "../st_asio_wrapper_base.h"
 
+//slab allocator, see slab_allocator for more details.
+//the size of each slab, must be bigger than or equal to ST_ASIO_SLAB_MSG_SIZE.
+#ifndef ST_ASIO_SLAB_SIZE
+#define ST_ASIO_SLAB_SIZE		65536
+#endif
+//msgs bigger than this will not be allocated from slabs, but from the heap (one allocation per msg) as usual.
+#ifndef ST_ASIO_SLAB_MSG_SIZE
+#if ST_ASIO_MSG_BUFFER_SIZE > ST_ASIO_SLAB_SIZE
+#define ST_ASIO_SLAB_MSG_SIZE	ST_ASIO_SLAB_SIZE
+#else
+#define ST_ASIO_SLAB_MSG_SIZE	ST_ASIO_MSG_BUFFER_SIZE
+#endif
+#endif
+//how many free slabs can be cached for reusing (shared by all threads), free slabs beyond this will be freed from the heap.
+#ifndef ST_ASIO_SLAB_CACHE_NUM
+#define ST_ASIO_SLAB_CACHE_NUM	64
+#endif
+//the initial (and minimum) size of unpackers' receive buffers, they grow on demand (up to the max msg size) and shrink back to this size
+//after all received data been consumed, see dynamic_buffer for more details.
+#ifndef ST_ASIO_MIN_RECV_BUFFER_SIZE
+#if ST_ASIO_MSG_BUFFER_SIZE > 4096
+#define ST_ASIO_MIN_RECV_BUFFER_SIZE	4096
+#else
+#define ST_ASIO_MIN_RECV_BUFFER_SIZE	ST_ASIO_MSG_BUFFER_SIZE
+#endif
+#endif
+static_assert(ST_ASIO_MIN_RECV_BUFFER_SIZE >= 16 && ST_ASIO_MIN_RECV_BUFFER_SIZE <= ST_ASIO_MSG_BUFFER_SIZE, "invalid minimum receive buffer size.");
+//a grown receive buffer shrinks back only after this number of successive small reads (none of them exceeded ST_ASIO_MIN_RECV_BUFFER_SIZE),
+//so sessions that keep receiving big msgs will not reallocate their buffers over and over again.
+#ifndef ST_ASIO_RECV_BUFFER_SHRINK_NUM
+#define ST_ASIO_RECV_BUFFER_SHRINK_NUM	16
+#endif
+static_assert(ST_ASIO_RECV_BUFFER_SHRINK_NUM > 0, "receive buffer shrink number must be bigger than zero.");
+
+static_assert(ST_ASIO_SLAB_MSG_SIZE > 0 && ST_ASIO_SLAB_SIZE >= ST_ASIO_SLAB_MSG_SIZE, "slab size must be bigger than or equal to slab msg size.");
+
 namespace st_asio_wrapper { namespace ext {
 
 //implement i_buffer interface, then string_buffer can be wrapped by replaceable_buffer
@@ -60,6 +96,221 @@ protected:
 	size_t len, buff_len;
 };
 
+//a receive buffer whose size can be changed at runtime (between min_size and max_size), used by unpackers.
+//unpackers grow it when a msg cannot fit in it, and shrink it back to min_size when all received data been consumed and the last
+//ST_ASIO_RECV_BUFFER_SHRINK_NUM reads were all small, shrinking happens only when data arrives, so a session which goes idle keeps its buffer
+//(even a grown one) until st_tcp_socket releases it (see ST_ASIO_RECV_BUFFER_RELEASE_INTERVAL), after that, the session occupies no receive buffer
+//until data arrives again.
+class dynamic_buffer : public boost::noncopyable
+{
+public:
+	dynamic_buffer() : buff(nullptr), buff_len(0), small_num(0) {size_limit(ST_ASIO_MIN_RECV_BUFFER_SIZE, ST_ASIO_MSG_BUFFER_SIZE);}
+	~dynamic_buffer() {delete[] buff;}
+
+	void size_limit(size_t min_size, size_t max_size) {assert(0 < min_size && min_size <= max_size); min_size_ = min_size; max_size_ = max_size;}
+	size_t min_size() const {return min_size_;}
+	size_t max_size() const {return max_size_;}
+	void max_size(size_t max_size) {size_limit(std::min(min_size_, max_size), max_size);}
+
+	char* data() {return buff;}
+	const char* data() const {return buff;}
+	size_t size() const {return buff_len;}
+
+	//change the buffer's size to len (limited by min_size and max_size), the first keep_len bytes will be kept.
+	void resize(size_t len, size_t keep_len = 0)
+	{
+		len = std::max(min_size_, std::min(len, max_size_));
+		assert(keep_len <= len && keep_len <= buff_len);
+		if (len != buff_len)
+		{
+			auto new_buff = new char[len];
+			if (keep_len > 0)
+				memcpy(new_buff, buff, keep_len);
+			delete[] buff;
+
+			buff = new_buff;
+			buff_len = len;
+		}
+	}
+	//make sure the buffer can hold len bytes (if max_size permits), keep the first keep_len bytes.
+	void grow(size_t len, size_t keep_len) {if (len > buff_len) resize(std::max(len, 2 * buff_len), keep_len);}
+	//record how many bytes are in the buffer after a read (including left behind data).
+	void used(size_t len) {if (len > min_size_) small_num = 0; else if (small_num < ST_ASIO_RECV_BUFFER_SHRINK_NUM) ++small_num;}
+	//shrink back to min_size after ST_ASIO_RECV_BUFFER_SHRINK_NUM successive small reads, also allocates the buffer at the first time.
+	void shrink() {if (nullptr == buff || (buff_len > min_size_ && small_num >= ST_ASIO_RECV_BUFFER_SHRINK_NUM)) resize(0);}
+	//free the buffer, shrink() will allocate a min_size buffer again.
+	void release() {delete[] buff; buff = nullptr; buff_len = 0; small_num = 0;}
+
+protected:
+	char* buff;
+	size_t buff_len, min_size_, max_size_;
+	size_t small_num; //successive small reads
+};
+
+//a fixed size memory block, msgs are allocated from it by bumping a pointer, it will be reused or freed after all msgs in it been freed.
+class slab : public boost::noncopyable
+{
+public:
+	static slab* create(size_t capacity) {return new (::operator new(sizeof(slab) + capacity)) slab(capacity);}
+	static void destroy(slab* s) {s->~slab(); ::operator delete(s);}
+
+	char* data() {return (char*) (this + 1);}
+	size_t capacity() const {return capacity_;}
+	size_t use_count() const {return ref;}
+
+	void add_ref() {++ref;}
+	inline void release();
+
+private:
+	friend class slab_allocator;
+	slab(size_t capacity) : ref(0), used(0), capacity_(capacity) {}
+
+	st_atomic_size_t ref; //every msg allocated from this slab holds one reference, the thread which is allocating msgs from this slab holds one reference too
+	size_t used; //only accessed by the allocating thread
+	size_t capacity_;
+};
+
+//per-thread bump pointer allocator backed by slabs.
+//each thread allocates msgs from its own current slab without any locks, slabs are shared between threads only when they're
+//released (by the last msg) and cached for reusing, this is protected by a mutex, but it happens only once per slab (batched).
+//please note that a slab will be kept until all msgs in it been freed, so holding a small msg for a long time will hold the whole slab.
+class slab_allocator
+{
+public:
+	//allocate len bytes, returned memory is referenced by s (already add_ref()'ed), call s->release() to free it.
+	static char* allocate(size_t len, slab*& s)
+	{
+		if (len > ST_ASIO_SLAB_MSG_SIZE) //big msg, allocated from the heap directly
+		{
+			s = slab::create(len);
+			s->used = len;
+			s->add_ref();
+			return s->data();
+		}
+
+		auto a = get_arena();
+		if (nullptr == a->cur || a->cur->capacity() - a->cur->used < len)
+		{
+			if (nullptr != a->cur && 1 == a->cur->ref) //all msgs in current slab have been freed, reuse it without any locks
+				a->cur->used = 0;
+			else
+			{
+				if (nullptr != a->cur)
+					a->cur->release();
+				a->cur = get_slab();
+				a->cur->add_ref(); //the arena's reference
+			}
+		}
+
+		s = a->cur;
+		auto p = std::next(s->data(), s->used);
+		s->used += len;
+		s->add_ref();
+		return p;
+	}
+
+	//get a whole slab (with ST_ASIO_SLAB_SIZE capacity) from the cache or the heap, the caller must add_ref() it.
+	static slab* get_slab()
+	{
+		auto& c = get_cache();
+		boost::unique_lock<boost::mutex> lock(c.mutex);
+		if (!c.slabs.empty())
+		{
+			auto s = c.slabs.back();
+			c.slabs.pop_back();
+			lock.unlock();
+
+			s->used = 0;
+			return s;
+		}
+		lock.unlock();
+
+		return slab::create(ST_ASIO_SLAB_SIZE);
+	}
+
+	static size_t cached_slab_num() {auto& c = get_cache(); boost::lock_guard<boost::mutex> lock(c.mutex); return c.slabs.size();}
+
+private:
+	friend class slab;
+	struct arena
+	{
+		arena() : cur(nullptr) {}
+		~arena() {if (nullptr != cur) cur->release();}
+
+		slab* cur;
+	};
+
+	struct cache
+	{
+		std::vector<slab*> slabs;
+		boost::mutex mutex;
+	};
+
+	static arena* get_arena()
+	{
+		static boost::thread_specific_ptr<arena> arenas;
+		auto a = arenas.get();
+		if (nullptr == a)
+			arenas.reset(a = new arena());
+
+		return a;
+	}
+
+	//never freed, because arenas of some threads may be destroyed after static objects
+	static cache& get_cache() {static auto c = new cache(); return *c;}
+
+	static void recycle(slab* s)
+	{
+		if (ST_ASIO_SLAB_SIZE == s->capacity())
+		{
+			auto& c = get_cache();
+			boost::unique_lock<boost::mutex> lock(c.mutex);
+			if (c.slabs.size() < ST_ASIO_SLAB_CACHE_NUM)
+			{
+				c.slabs.push_back(s);
+				return;
+			}
+		}
+
+		slab::destroy(s);
+	}
+};
+
+void slab::release() {if (0 == --ref) slab_allocator::recycle(this);}
+
+//a refcounted slice of a slab, copying it will not copy the memory (like shared_buffer).
+//used by slab_packer and slab_unpacker, packing a msg (not bigger than ST_ASIO_SLAB_MSG_SIZE) is just a bump pointer allocation in most cases.
+class slab_buffer
+{
+public:
+	slab_buffer() : s(nullptr), buff(nullptr), len(0) {}
+	slab_buffer(size_t len_) : s(nullptr), buff(nullptr), len(0) {assign(len_);}
+	slab_buffer(const slab_buffer& other) : s(other.s), buff(other.buff), len(other.len) {if (nullptr != s) s->add_ref();}
+	slab_buffer(slab_buffer&& other) : s(other.s), buff(other.buff), len(other.len) {other.s = nullptr; other.buff = nullptr; other.len = 0;}
+	~slab_buffer() {clear();}
+
+	slab_buffer& operator=(const slab_buffer& other) {slab_buffer(other).swap(*this); return *this;}
+	slab_buffer& operator=(slab_buffer&& other) {clear(); swap(other); return *this;}
+
+	void assign(size_t len_) {clear(); if (len_ > 0) {buff = slab_allocator::allocate(len_, s); len = len_;}}
+
+	//the following five functions are needed by st_asio_wrapper
+	bool empty() const {return 0 == len;}
+	size_t size() const {return len;}
+	const char* data() const {return buff;}
+	void swap(slab_buffer& other) {std::swap(s, other.s); std::swap(buff, other.buff); std::swap(len, other.len);}
+	void clear() {if (nullptr != s) s->release(); s = nullptr; buff = nullptr; len = 0;}
+
+	//functions needed by packer and unpacker
+	char* data() {return buff;}
+	void attach(slab* s_, char* buff_, size_t len_) {assert(nullptr != s_); s_->add_ref(); clear(); s = s_; buff = buff_; len = len_;}
+
+protected:
+	slab* s;
+	char* buff;
+	size_t len;
+};
+
 }} //namespace
 
 #endif /* ST_ASIO_WRAPPER_EXT_H_ */
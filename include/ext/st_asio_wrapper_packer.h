@@ -121,6 +121,60 @@ public:
 	virtual size_t raw_data_len(typename super::msg_ctype& msg) const {return msg.size() - ST_ASIO_HEAD_LEN;}
 };
 
+//protocol: length + body
+//msgs are allocated from slabs (see slab_allocator), so packing msgs not bigger than ST_ASIO_SLAB_MSG_SIZE will not allocate memory from the heap
+//in most cases, and the memory will be given back to slabs when the msgs been sent (or been freed).
+class slab_packer : public i_packer<slab_buffer>
+{
+public:
+	static size_t get_max_msg_size() {return ST_ASIO_MSG_BUFFER_SIZE - ST_ASIO_HEAD_LEN;}
+
+	using i_packer<msg_type>::pack_msg;
+	virtual msg_type pack_msg(const char* const pstr[], const size_t len[], size_t num, bool native = false)
+	{
+		msg_type msg;
+		auto pre_len = native ? 0 : ST_ASIO_HEAD_LEN;
+		auto total_len = packer_helper::msg_size_check(pre_len, pstr, len, num);
+		if ((size_t) -1 == total_len)
+			return msg;
+		else if (total_len > pre_len)
+		{
+			ST_ASIO_HEAD_TYPE head_len = 0;
+			if (!native)
+			{
+				head_len = (ST_ASIO_HEAD_TYPE) total_len;
+				if (total_len != head_len)
+				{
+					unified_out::error_out("pack msg error: length exceeded the header's range!");
+					return msg;
+				}
+				head_len = ST_ASIO_HEAD_H2N(head_len);
+			}
+
+			msg.assign(total_len);
+			auto p = msg.data();
+			if (!native)
+			{
+				memcpy(p, &head_len, ST_ASIO_HEAD_LEN);
+				std::advance(p, ST_ASIO_HEAD_LEN);
+			}
+
+			for (size_t i = 0; i < num; ++i)
+				if (nullptr != pstr[i])
+				{
+					memcpy(p, pstr[i], len[i]);
+					std::advance(p, len[i]);
+				}
+		} //if (total_len > pre_len)
+
+		return msg;
+	}
+
+	virtual char* raw_data(msg_type& msg) const {return std::next(msg.data(), ST_ASIO_HEAD_LEN);}
+	virtual const char* raw_data(msg_ctype& msg) const {return std::next(msg.data(), ST_ASIO_HEAD_LEN);}
+	virtual size_t raw_data_len(msg_ctype& msg) const {return msg.size() - ST_ASIO_HEAD_LEN;}
+};
+
 //protocol: fixed lenght
 class fixed_length_packer : public packer
 {
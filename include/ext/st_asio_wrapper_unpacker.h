@@ -13,8 +13,6 @@
 #ifndef ST_ASIO_WRAPPER_EXT_UNPACKER_H_
 #define ST_ASIO_WRAPPER_EXT_UNPACKER_H_
 
-#include <boost/array.hpp>
-
 #include "st_asio_wrapper_ext.h"
 
 #ifdef ST_ASIO_HUGE_MSG
@@ -35,18 +33,23 @@ public:
 	unpacker() {reset_state();}
 	size_t current_msg_length() const {return cur_msg_len;} //current msg's total length, -1 means not available
 
+	//the receive buffer grows on demand up to this size, it must be set before the socket starts to receive data (or in reset_state)
+	void max_msg_size(size_t max_size) {assert(max_size > ST_ASIO_HEAD_LEN); raw_buff.max_size(max_size);}
+	size_t max_msg_size() const {return raw_buff.max_size();}
+
 	bool parse_msg(size_t bytes_transferred, boost::container::list<std::pair<const char*, size_t>>& msg_can)
 	{
 		//length + msg
 		remain_len += bytes_transferred;
-		assert(remain_len <= ST_ASIO_MSG_BUFFER_SIZE);
+		assert(remain_len <= raw_buff.size());
+		raw_buff.used(remain_len);
 
-		auto pnext = std::begin(raw_buff);
+		auto pnext = raw_buff.data();
 		auto unpack_ok = true;
 		while (unpack_ok) //considering stick package problem, we need a loop
 			if ((size_t) -1 != cur_msg_len)
 			{
-				if (cur_msg_len > ST_ASIO_MSG_BUFFER_SIZE || cur_msg_len <= ST_ASIO_HEAD_LEN)
+				if (cur_msg_len > raw_buff.max_size() || cur_msg_len <= ST_ASIO_HEAD_LEN)
 					unpack_ok = false;
 				else if (remain_len >= cur_msg_len) //one msg received
 				{
@@ -67,7 +70,8 @@ public:
 			else
 				break;
 
-		if (pnext == std::begin(raw_buff)) //we should have at least got one msg.
+		//we should have at least got one msg, unless the receive buffer needs to grow.
+		if (pnext == raw_buff.data() && ((size_t) -1 == cur_msg_len || cur_msg_len <= raw_buff.size()))
 			unpack_ok = false;
 
 		return unpack_ok;
@@ -81,10 +85,10 @@ public:
 		auto unpack_ok = parse_msg(bytes_transferred, msg_pos_can);
 		do_something_to_all(msg_pos_can, [&msg_can](decltype(msg_pos_can.front())& item) {msg_can.resize(msg_can.size() + 1); msg_can.back().assign(item.first, item.second);});
 
-		if (unpack_ok && remain_len > 0)
+		if (unpack_ok && remain_len > 0 && !msg_pos_can.empty())
 		{
 			auto pnext = std::next(msg_pos_can.back().first, msg_pos_can.back().second);
-			memcpy(std::begin(raw_buff), pnext, remain_len); //left behind unparsed data
+			memmove(raw_buff.data(), pnext, remain_len); //left behind unparsed data
 		}
 
 		//if unpacking failed, successfully parsed msgs will still returned via msg_can(stick package), please note.
@@ -100,42 +104,56 @@ public:
 			return 0;
 
 		auto data_len = remain_len + bytes_transferred;
-		assert(data_len <= ST_ASIO_MSG_BUFFER_SIZE);
+		assert(data_len <= raw_buff.size());
 
 		if ((size_t) -1 == cur_msg_len && data_len >= ST_ASIO_HEAD_LEN) //the msg's head been received
 		{
 			ST_ASIO_HEAD_TYPE head;
-			memcpy(&head, std::begin(raw_buff), ST_ASIO_HEAD_LEN);
+			memcpy(&head, raw_buff.data(), ST_ASIO_HEAD_LEN);
 			cur_msg_len = ST_ASIO_HEAD_N2H(head);
-			if (cur_msg_len > ST_ASIO_MSG_BUFFER_SIZE || cur_msg_len <= ST_ASIO_HEAD_LEN) //invalid msg, stop reading
+			if (cur_msg_len > raw_buff.max_size() || cur_msg_len <= ST_ASIO_HEAD_LEN) //invalid msg, stop reading
 				return 0;
 		}
 
-		return data_len >= cur_msg_len ? 0 : boost::asio::detail::default_max_transfer_size;
-		//read as many as possible except that we have already got an entire msg
+		return (size_t) -1 != cur_msg_len && (data_len >= cur_msg_len || cur_msg_len > raw_buff.size()) ? 0 : boost::asio::detail::default_max_transfer_size;
+		//read as many as possible except that we have already got an entire msg or the receive buffer needs to grow
 	}
 
 	virtual boost::asio::mutable_buffers_1 prepare_next_recv()
 	{
-		assert(remain_len < ST_ASIO_MSG_BUFFER_SIZE);
-		return boost::asio::buffer(boost::asio::buffer(raw_buff) + remain_len);
+		if (0 == remain_len)
+			raw_buff.shrink();
+		else
+			raw_buff.grow((size_t) -1 == cur_msg_len ? ST_ASIO_HEAD_LEN : cur_msg_len, remain_len);
+
+		assert(remain_len < raw_buff.size());
+		return boost::asio::buffer(raw_buff.data() + remain_len, raw_buff.size() - remain_len);
 	}
 
+	virtual bool releasable() const {return 0 == remain_len && raw_buff.size() > 0;}
+	virtual void release_buffer() {assert(0 == remain_len); raw_buff.release();}
+
 protected:
-	boost::array<char, ST_ASIO_MSG_BUFFER_SIZE> raw_buff;
+	dynamic_buffer raw_buff;
 	size_t cur_msg_len; //-1 means head not received, so msg length is not available.
 	size_t remain_len; //half-baked msg
 };
 
 //protocol: UDP has message boundary, so we don't need a specific protocol to unpack it.
+//the receive buffer must be able to hold the biggest datagram, so it cannot grow on demand, but it's allocated at the first receiving
+//with max_msg_size (which can be changed at runtime) rather than a fixed ST_ASIO_MSG_BUFFER_SIZE array.
 class udp_unpacker : public i_udp_unpacker<std::string>
 {
 public:
-	virtual msg_type parse_msg(size_t bytes_transferred) {assert(bytes_transferred <= ST_ASIO_MSG_BUFFER_SIZE); return msg_type(raw_buff.data(), bytes_transferred);}
-	virtual boost::asio::mutable_buffers_1 prepare_next_recv() {return boost::asio::buffer(raw_buff);}
+	void max_msg_size(size_t max_size) {raw_buff.size_limit(max_size, max_size);}
+	size_t max_msg_size() const {return raw_buff.max_size();}
+
+public:
+	virtual msg_type parse_msg(size_t bytes_transferred) {assert(bytes_transferred <= raw_buff.size()); return msg_type(raw_buff.data(), bytes_transferred);}
+	virtual boost::asio::mutable_buffers_1 prepare_next_recv() {raw_buff.resize(raw_buff.max_size()); return boost::asio::buffer(raw_buff.data(), raw_buff.size());}
 
 protected:
-	boost::array<char, ST_ASIO_MSG_BUFFER_SIZE> raw_buff;
+	dynamic_buffer raw_buff;
 };
 
 //protocol: length + body
@@ -146,6 +164,10 @@ class replaceable_unpacker : public i_unpacker<T>
 protected:
 	typedef i_unpacker<T> super;
 
+public:
+	void max_msg_size(size_t max_size) {unpacker_.max_msg_size(max_size);}
+	size_t max_msg_size() const {return unpacker_.max_msg_size();}
+
 public:
 	virtual void reset_state() {unpacker_.reset_state();}
 	virtual bool parse_msg(size_t bytes_transferred, typename super::container_type& msg_can)
@@ -165,6 +187,8 @@ public:
 
 	virtual size_t completion_condition(const boost::system::error_code& ec, size_t bytes_transferred) {return unpacker_.completion_condition(ec, bytes_transferred);}
 	virtual boost::asio::mutable_buffers_1 prepare_next_recv() {return unpacker_.prepare_next_recv();}
+	virtual bool releasable() const {return unpacker_.releasable();}
+	virtual void release_buffer() {unpacker_.release_buffer();}
 
 protected:
 	unpacker unpacker_;
@@ -178,19 +202,23 @@ class replaceable_udp_unpacker : public i_udp_unpacker<T>
 protected:
 	typedef i_packer<T> super;
 
+public:
+	void max_msg_size(size_t max_size) {raw_buff.size_limit(max_size, max_size);}
+	size_t max_msg_size() const {return raw_buff.max_size();}
+
 public:
 	virtual typename super::msg_type parse_msg(size_t bytes_transferred)
 	{
-		assert(bytes_transferred <= ST_ASIO_MSG_BUFFER_SIZE);
+		assert(bytes_transferred <= raw_buff.size());
 
 		auto raw_msg = new string_buffer();
 		raw_msg->assign(raw_buff.data(), bytes_transferred);
 		return typename super::msg_type(raw_msg);
 	}
-	virtual boost::asio::mutable_buffers_1 prepare_next_recv() {return boost::asio::buffer(raw_buff);}
+	virtual boost::asio::mutable_buffers_1 prepare_next_recv() {raw_buff.resize(raw_buff.max_size()); return boost::asio::buffer(raw_buff.data(), raw_buff.size());}
 
 protected:
-	boost::array<char, ST_ASIO_MSG_BUFFER_SIZE> raw_buff;
+	dynamic_buffer raw_buff;
 };
 
 //protocol: length + body
@@ -269,6 +297,132 @@ private:
 	int step; //-1-error format, 0-want the head, 1-want the body
 };
 
+//protocol: length + body
+//receive data into slabs (see slab_allocator) and return msgs as refcounted slices of them, so no memory replication and allocation
+//needed while parsing msgs, the only copy happens when a msg straddles two slabs (just the received part of it will be copied to the new slab).
+//please note that a slab will be kept until all msgs in it been freed, so don't hold msgs for a long time.
+class slab_unpacker : public i_unpacker<slab_buffer>
+{
+public:
+	slab_unpacker() : blk(nullptr) {reset_state();}
+	~slab_unpacker() {if (nullptr != blk) blk->release();}
+	size_t current_msg_length() const {return cur_msg_len;} //current msg's total length, -1 means not available
+
+public:
+	virtual void reset_state() {cur_msg_len = -1; begin = remain_len = 0;}
+	virtual bool parse_msg(size_t bytes_transferred, container_type& msg_can)
+	{
+		//length + msg
+		remain_len += bytes_transferred;
+		assert(nullptr != blk && begin + remain_len <= blk->capacity());
+
+		auto pbegin = std::next(blk->data(), begin);
+		auto pnext = pbegin;
+		auto unpack_ok = true;
+		while (unpack_ok) //considering stick package problem, we need a loop
+			if ((size_t) -1 != cur_msg_len)
+			{
+				if (cur_msg_len > ST_ASIO_MSG_BUFFER_SIZE || cur_msg_len <= ST_ASIO_HEAD_LEN)
+					unpack_ok = false;
+				else if (remain_len >= cur_msg_len) //one msg received
+				{
+					msg_can.resize(msg_can.size() + 1);
+					msg_can.back().attach(blk, std::next(pnext, ST_ASIO_HEAD_LEN), cur_msg_len - ST_ASIO_HEAD_LEN);
+					remain_len -= cur_msg_len;
+					std::advance(pnext, cur_msg_len);
+					cur_msg_len = -1;
+				}
+				else
+					break;
+			}
+			else if (remain_len >= ST_ASIO_HEAD_LEN) //the msg's head been received, stick package found
+			{
+				ST_ASIO_HEAD_TYPE head;
+				memcpy(&head, pnext, ST_ASIO_HEAD_LEN);
+				cur_msg_len = ST_ASIO_HEAD_N2H(head);
+			}
+			else
+				break;
+
+		if (pnext == pbegin) //we should have at least got one msg.
+			unpack_ok = false;
+		else
+			begin += std::distance(pbegin, pnext); //left behind unparsed data in place
+
+		//if unpacking failed, successfully parsed msgs will still returned via msg_can(stick package), please note.
+		return unpack_ok;
+	}
+
+	//a return value of 0 indicates that the read operation is complete. a non-zero value indicates the maximum number
+	//of bytes to be read on the next call to the stream's async_read_some function. ---boost::asio::async_read
+	//read as many as possible to reduce asynchronous call-back, and don't forget to handle stick package carefully in parse_msg function.
+	virtual size_t completion_condition(const boost::system::error_code& ec, size_t bytes_transferred)
+	{
+		if (ec)
+			return 0;
+
+		auto data_len = remain_len + bytes_transferred;
+		assert(nullptr != blk && begin + data_len <= blk->capacity());
+
+		if ((size_t) -1 == cur_msg_len && data_len >= ST_ASIO_HEAD_LEN) //the msg's head been received
+		{
+			ST_ASIO_HEAD_TYPE head;
+			memcpy(&head, std::next(blk->data(), begin), ST_ASIO_HEAD_LEN);
+			cur_msg_len = ST_ASIO_HEAD_N2H(head);
+			if (cur_msg_len > ST_ASIO_MSG_BUFFER_SIZE || cur_msg_len <= ST_ASIO_HEAD_LEN) //invalid msg, stop reading
+				return 0;
+		}
+
+		return data_len >= cur_msg_len ? 0 : boost::asio::detail::default_max_transfer_size;
+		//read as many as possible except that we have already got an entire msg
+	}
+
+	virtual boost::asio::mutable_buffers_1 prepare_next_recv()
+	{
+		//make sure that the rest space of current slab can hold the whole current msg
+		auto need = (size_t) -1 == cur_msg_len ? ST_ASIO_MSG_BUFFER_SIZE : cur_msg_len;
+		assert(remain_len < need);
+
+		if (nullptr == blk)
+			switch_slab();
+		else if (1 == blk->use_count()) //no msgs refer to current slab, reuse it from the beginning
+		{
+			if (begin > 0)
+			{
+				if (remain_len > 0)
+					memmove(blk->data(), std::next(blk->data(), begin), remain_len);
+				begin = 0;
+			}
+		}
+		else if (blk->capacity() - begin < need)
+			switch_slab();
+
+		return boost::asio::buffer(boost::asio::buffer(blk->data(), blk->capacity()) + (begin + remain_len));
+	}
+
+protected:
+	void switch_slab()
+	{
+		auto s = ST_ASIO_SLAB_SIZE >= ST_ASIO_MSG_BUFFER_SIZE ? slab_allocator::get_slab() : slab::create(ST_ASIO_MSG_BUFFER_SIZE);
+		s->add_ref(); //the unpacker's reference
+		if (nullptr != blk)
+		{
+			if (remain_len > 0) //the msg straddles two slabs
+				memcpy(s->data(), std::next(blk->data(), begin), remain_len);
+			blk->release();
+		}
+
+		blk = s;
+		begin = 0;
+	}
+
+protected:
+	slab* blk;
+	size_t cur_msg_len; //-1 means head not received, so msg length is not available.
+	size_t begin; //where the unparsed data begins in blk
+	size_t remain_len; //half-baked msg
+};
+
 //protocol: fixed lenght
 //non-copy
 class fixed_length_unpacker : public i_unpacker<basic_buffer>
@@ -309,10 +463,14 @@ class prefix_suffix_unpacker : public i_unpacker<std::string>
 public:
 	prefix_suffix_unpacker() {reset_state();}
 
-	void prefix_suffix(const std::string& prefix, const std::string& suffix) {assert(!suffix.empty() && prefix.size() + suffix.size() < ST_ASIO_MSG_BUFFER_SIZE); _prefix = prefix; _suffix = suffix;}
+	void prefix_suffix(const std::string& prefix, const std::string& suffix) {assert(!suffix.empty() && prefix.size() + suffix.size() < raw_buff.max_size()); _prefix = prefix; _suffix = suffix;}
 	const std::string& prefix() const {return _prefix;}
 	const std::string& suffix() const {return _suffix;}
 
+	//the receive buffer grows on demand up to this size, it must be set before the socket starts to receive data (or in reset_state)
+	void max_msg_size(size_t max_size) {assert(_prefix.size() + _suffix.size() < max_size); raw_buff.max_size(max_size);}
+	size_t max_msg_size() const {return raw_buff.max_size();}
+
 	size_t peek_msg(size_t data_len, const char* buff)
 	{
 		assert(nullptr != buff);
@@ -334,10 +492,13 @@ public:
 				first_msg_len = std::distance(buff, end) + _suffix.size(); //got a msg
 				return 0;
 			}
-			else if (data_len >= ST_ASIO_MSG_BUFFER_SIZE)
+			else if (data_len >= raw_buff.max_size())
 				return 0; //invalid msg, stop reading
 		}
 
+		if (data_len >= raw_buff.size())
+			return 0; //the receive buffer needs to grow
+
 		return boost::asio::detail::default_max_transfer_size; //read as many as possible
 	}
 
@@ -361,11 +522,12 @@ public:
 	{
 		//length + msg
 		remain_len += bytes_transferred;
-		assert(remain_len <= ST_ASIO_MSG_BUFFER_SIZE);
+		assert(remain_len <= raw_buff.size());
+		raw_buff.used(remain_len);
 
 		auto min_len = _prefix.size() + _suffix.size();
 		auto unpack_ok = true;
-		auto pnext = std::begin(raw_buff);
+		auto pnext = raw_buff.data();
 		while ((size_t) -1 != first_msg_len && 0 != first_msg_len)
 		{
 			assert(first_msg_len > min_len);
@@ -383,10 +545,10 @@ public:
 				unpack_ok = false;
 		}
 
-		if (pnext == std::begin(raw_buff)) //we should have at least got one msg.
-			return false;
+		if (pnext == raw_buff.data()) //we should have at least got one msg, unless the receive buffer needs to grow.
+			return (size_t) -1 != first_msg_len && remain_len >= raw_buff.size() && remain_len < raw_buff.max_size();
 		else if (unpack_ok && remain_len > 0)
-			memcpy(std::begin(raw_buff), pnext, remain_len); //left behind unparsed msg
+			memmove(raw_buff.data(), pnext, remain_len); //left behind unparsed msg
 
 		//if unpacking failed, successfully parsed msgs will still returned via msg_can(stick package), please note.
 		return unpack_ok;
@@ -401,27 +563,42 @@ public:
 			return 0;
 
 		auto data_len = remain_len + bytes_transferred;
-		assert(data_len <= ST_ASIO_MSG_BUFFER_SIZE);
+		assert(data_len <= raw_buff.size());
 
-		return peek_msg(data_len, std::begin(raw_buff));
+		return peek_msg(data_len, raw_buff.data());
 	}
 
 	virtual boost::asio::mutable_buffers_1 prepare_next_recv()
 	{
-		assert(remain_len < ST_ASIO_MSG_BUFFER_SIZE);
-		return boost::asio::buffer(boost::asio::buffer(raw_buff) + remain_len);
+		if (0 == remain_len)
+			raw_buff.shrink();
+		else
+			raw_buff.grow(remain_len + 1, remain_len);
+
+		assert(remain_len < raw_buff.size());
+		return boost::asio::buffer(raw_buff.data() + remain_len, raw_buff.size() - remain_len);
 	}
 
+	virtual bool releasable() const {return 0 == remain_len && raw_buff.size() > 0;}
+	virtual void release_buffer() {assert(0 == remain_len); raw_buff.release();}
+
 private:
-	boost::array<char, ST_ASIO_MSG_BUFFER_SIZE> raw_buff;
+	dynamic_buffer raw_buff;
 	std::string _prefix, _suffix;
 	size_t first_msg_len;
 	size_t remain_len; //half-baked msg
 };
 
 //protocol: stream (non-protocol)
+//the receive buffer grows (up to max_msg_size) if the last read filled it up, and shrinks back if not.
 class stream_unpacker : public i_unpacker<std::string>
 {
+public:
+	stream_unpacker() : last_len(0) {}
+
+	void max_msg_size(size_t max_size) {raw_buff.max_size(max_size);}
+	size_t max_msg_size() const {return raw_buff.max_size();}
+
 public:
 	virtual void reset_state() {}
 	virtual bool parse_msg(size_t bytes_transferred, container_type& msg_can)
@@ -429,18 +606,33 @@ public:
 		if (0 == bytes_transferred)
 			return false;
 
-		assert(bytes_transferred <= ST_ASIO_MSG_BUFFER_SIZE);
+		assert(bytes_transferred <= raw_buff.size());
 
 		msg_can.resize(msg_can.size() + 1);
 		msg_can.back().assign(raw_buff.data(), bytes_transferred);
+		last_len = bytes_transferred;
+		raw_buff.used(last_len);
 		return true;
 	}
 
 	virtual size_t completion_condition(const boost::system::error_code& ec, size_t bytes_transferred) {return ec || bytes_transferred > 0 ? 0 : boost::asio::detail::default_max_transfer_size;}
-	virtual boost::asio::mutable_buffers_1 prepare_next_recv() {return boost::asio::buffer(raw_buff);}
+	virtual boost::asio::mutable_buffers_1 prepare_next_recv()
+	{
+		if (last_len == raw_buff.size() && last_len > 0)
+			raw_buff.grow(last_len + 1, 0);
+		else
+			raw_buff.shrink();
+
+		last_len = 0;
+		return boost::asio::buffer(raw_buff.data(), raw_buff.size());
+	}
+
+	virtual bool releasable() const {return raw_buff.size() > 0;}
+	virtual void release_buffer() {raw_buff.release(); last_len = 0;}
 
 protected:
-	boost::array<char, ST_ASIO_MSG_BUFFER_SIZE> raw_buff;
+	dynamic_buffer raw_buff;
+	size_t last_len;
 };
 
 }} //namespace
@@ -21,6 +21,7 @@
 
 #include <string>
 #include <sstream>
+#include <type_traits>
 
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
@@ -58,6 +59,32 @@ static_assert(ST_ASIO_MAX_MSG_NUM > 0, "message capacity must be bigger than zer
 #define ST_THIS this->
 #endif
 
+#ifdef ST_ASIO_FULL_STATISTIC
+//the clock used by statistic (when ST_ASIO_FULL_STATISTIC defined), it must be a class which has a static function
+//'int_fast64_t now()' returning monotonic nanoseconds, for example a calibrated TSC clock, st_asio_wrapper::stat_clock will be used if not defined.
+//#define ST_ASIO_STAT_CLOCK my_clock
+
+#ifndef ST_ASIO_STAT_CLOCK
+#define ST_ASIO_STAT_CLOCK st_asio_wrapper::stat_clock
+#endif
+
+//on linux, stat_clock uses clock_gettime (vdso, no system call) with ST_ASIO_STAT_CLOCK_ID,
+//CLOCK_MONOTONIC_COARSE is the cheapest, its resolution is one tick (1~4 milliseconds), sums of durations are still right statistically
+//(a short duration counts as one tick or zero, with the right probability), but distributions are not, so if ST_ASIO_STAT_HISTOGRAM is defined,
+//CLOCK_MONOTONIC will be used by default.
+#ifdef __linux__
+#ifndef ST_ASIO_STAT_CLOCK_ID
+	#if defined(ST_ASIO_STAT_HISTOGRAM) || !defined(CLOCK_MONOTONIC_COARSE)
+	#define ST_ASIO_STAT_CLOCK_ID CLOCK_MONOTONIC
+	#else
+	#define ST_ASIO_STAT_CLOCK_ID CLOCK_MONOTONIC_COARSE
+	#endif
+#endif
+#else
+#include <chrono>
+#endif
+#endif
+
 namespace st_asio_wrapper
 {
 
@@ -78,6 +105,7 @@ public:
 	//deliberately omitted operator--(int)
 	T operator-=(const T& value) {boost::unique_lock<boost::shared_mutex> lock(data_mutex); return data -= value;}
 	T operator=(const T& value) {boost::unique_lock<boost::shared_mutex> lock(data_mutex); return data = value;}
+	T exchange(const T& value) {boost::unique_lock<boost::shared_mutex> lock(data_mutex); T old = data; data = value; return old;}
 	operator T() const {return data;}
 
 private:
@@ -248,6 +276,13 @@ public:
 	virtual bool parse_msg(size_t bytes_transferred, container_type& msg_can) = 0;
 	virtual size_t completion_condition(const boost::system::error_code& ec, size_t bytes_transferred) = 0;
 	virtual boost::asio::mutable_buffers_1 prepare_next_recv() = 0;
+
+	//an unpacker which owns its receive buffer can let st_tcp_socket release that buffer while the session is idle (see ST_ASIO_RECV_BUFFER_RELEASE_INTERVAL).
+	//releasable() returns true if there's a receive buffer and no half-baked msg in it, then st_tcp_socket waits for the socket to become readable
+	//(without any buffer) before calling prepare_next_recv(), and calls release_buffer() if the waiting lasts too long,
+	//prepare_next_recv() must re-allocate the buffer after it been released.
+	virtual bool releasable() const {return false;}
+	virtual void release_buffer() {}
 };
 
 template<typename MsgType>
@@ -285,12 +320,166 @@ public:
 };
 //unpacker concept
 
+#ifdef ST_ASIO_FULL_STATISTIC
+//monotonic clock in nanoseconds, on other platforms than linux, std::chrono::steady_clock will be used.
+class stat_clock
+{
+public:
+#ifdef __linux__
+	static int_fast64_t now() {struct timespec ts; clock_gettime(ST_ASIO_STAT_CLOCK_ID, &ts); return (int_fast64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;}
+#else
+	static int_fast64_t now() {return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();}
+#endif
+};
+#endif
+
+//a counter which can be read by any threads at any time safely, but can only be updated by one thread at a time (not concurrently),
+//this is true for all counters in statistic (see st_socket::get_statistic), so a plain read-modify-write is enough, which is much cheaper than a locked one.
+class stat_counter
+{
+public:
+	stat_counter(uint_fast64_t value_ = 0) : value(value_) {}
+	stat_counter(const stat_counter& other) : value(other.load()) {}
+	stat_counter& operator=(const stat_counter& other) {store(other.load()); return *this;}
+
+	stat_counter& operator+=(uint_fast64_t value_) {store(load() + value_); return *this;}
+	stat_counter& operator++() {return *this += 1;}
+	operator uint_fast64_t() const {return load();}
+
+private:
+#if BOOST_VERSION >= 105300
+	uint_fast64_t load() const {return value.load(boost::memory_order_relaxed);}
+	void store(uint_fast64_t value_) {value.store(value_, boost::memory_order_relaxed);}
+#else
+	uint_fast64_t load() const {return value;}
+	void store(uint_fast64_t value_) {value = value_;}
+#endif
+
+private:
+	st_atomic_uint_fast64 value;
+};
+
+//log-linear (HDR style) histogram of durations in nanoseconds, each power of 2 (unit is 1024 nanoseconds) is split into 8 linear buckets,
+//so the relative error is at most 12.5%, durations longer than 2^32 units (about 73 minutes) are counted in the last bucket.
+//recording is O(1) and lock-free (follow the rules of stat_counter), and histograms can be aggregated by operator +=.
+class stat_histogram
+{
+public:
+	static const size_t UNIT_SHIFT = 10;
+	static const size_t SUB_BUCKET_BITS = 3;
+	static const size_t SUB_BUCKET_NUM = 1 << SUB_BUCKET_BITS;
+	static const size_t MAX_EXPONENT = 31;
+	static const size_t BUCKET_NUM = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_NUM;
+
+	void record(uint_fast64_t ns) {++buckets[bucket_index(ns >> UNIT_SHIFT)];}
+	stat_histogram& operator+=(const stat_histogram& other) {for (size_t i = 0; i < BUCKET_NUM; ++i) buckets[i] += other.buckets[i]; return *this;}
+
+	uint_fast64_t count() const {uint_fast64_t num = 0; for (size_t i = 0; i < BUCKET_NUM; ++i) num += buckets[i]; return num;}
+	//return the upper bound (nanoseconds) of the bucket which holds the q-quantile (0 < q <= 1), or 0 if nothing recorded.
+	uint_fast64_t percentile(double q) const
+	{
+		auto total = count();
+		if (0 == total)
+			return 0;
+
+		auto target = (uint_fast64_t) (q * total + .5);
+		if (0 == target)
+			target = 1;
+
+		uint_fast64_t num = 0;
+		for (size_t i = 0; i < BUCKET_NUM; ++i)
+			if ((num += buckets[i]) >= target)
+				return bucket_upper_bound(i);
+
+		return bucket_upper_bound(BUCKET_NUM - 1);
+	}
+	uint_fast64_t max() const {for (auto i = BUCKET_NUM; i > 0; --i) if (buckets[i - 1] > 0) return bucket_upper_bound(i - 1); return 0;}
+
+	std::string to_string() const
+	{
+		std::ostringstream s;
+		s << "count " << count() << ", p50 " << percentile(.5) / 1000 << "us, p90 " << percentile(.9) / 1000 << "us, p99 " << percentile(.99) / 1000
+			<< "us, p999 " << percentile(.999) / 1000 << "us, max " << max() / 1000 << "us";
+		return s.str();
+	}
+
+	static size_t bucket_index(uint_fast64_t units)
+	{
+		if (units < SUB_BUCKET_NUM)
+			return (size_t) units;
+
+		auto e = msb(units);
+		if (e > MAX_EXPONENT)
+			return BUCKET_NUM - 1;
+
+		return (e - SUB_BUCKET_BITS + 1) * SUB_BUCKET_NUM + (size_t) ((units >> (e - SUB_BUCKET_BITS)) & (SUB_BUCKET_NUM - 1));
+	}
+
+	static uint_fast64_t bucket_upper_bound(size_t index)
+	{
+		if (index < SUB_BUCKET_NUM)
+			return ((uint_fast64_t) index + 1) << UNIT_SHIFT;
+
+		auto e = index / SUB_BUCKET_NUM + SUB_BUCKET_BITS - 1;
+		return ((uint_fast64_t) (SUB_BUCKET_NUM + index % SUB_BUCKET_NUM + 1) << (e - SUB_BUCKET_BITS)) << UNIT_SHIFT;
+	}
+
+private:
+	static size_t msb(uint_fast64_t value)
+	{
+#ifdef __GNUC__
+		return 63 - __builtin_clzll(value);
+#else
+		size_t n = 0;
+		while (value >>= 1)
+			++n;
+		return n;
+#endif
+	}
+
+private:
+	stat_counter buckets[BUCKET_NUM];
+};
+
+//if defined (only take effect with ST_ASIO_FULL_STATISTIC), send delay, dispatch delay, on_msg duration, on_msg_handle duration and unpack duration
+//will also be recorded into histograms (see stat_histogram), so percentiles can be got. every histogram takes about 2KB memory, statistic has five of them.
+//#define ST_ASIO_STAT_HISTOGRAM
+
 struct statistic
 {
 #ifdef ST_ASIO_FULL_STATISTIC
-	typedef boost::posix_time::ptime stat_time;
-	static stat_time local_time() {return boost::date_time::microsec_clock<boost::posix_time::ptime>::local_time();}
-	typedef boost::posix_time::time_duration stat_duration;
+	typedef int_fast64_t stat_time; //nanoseconds from ST_ASIO_STAT_CLOCK
+	static stat_time local_time() {return ST_ASIO_STAT_CLOCK::now();}
+	typedef int_fast64_t stat_duration; //nanoseconds
+	static uint_fast64_t to_nanoseconds(const stat_duration& duration) {return duration < 0 ? 0 : (uint_fast64_t) duration;}
+
+	//sum of durations
+	class duration_sum
+	{
+	public:
+		duration_sum& operator+=(const stat_duration& duration) {ns += to_nanoseconds(duration); return *this;}
+		duration_sum& operator+=(const duration_sum& other) {ns += other.ns; return *this;}
+		uint_fast64_t nanoseconds() const {return ns;}
+
+	protected:
+		stat_counter ns;
+	};
+
+#ifdef ST_ASIO_STAT_HISTOGRAM
+	//sum and distribution of durations
+	class duration_dist : public duration_sum
+	{
+	public:
+		duration_dist& operator+=(const stat_duration& duration) {auto ns_ = to_nanoseconds(duration); ns += ns_; dist.record(ns_); return *this;}
+		duration_dist& operator+=(const duration_dist& other) {duration_sum::operator+=(other); dist += other.dist; return *this;}
+		const stat_histogram& histogram() const {return dist;}
+
+	private:
+		stat_histogram dist;
+	};
+#else
+	typedef duration_sum duration_dist;
+#endif
 #else
 	struct dummy_duration {const dummy_duration& operator +=(const dummy_duration& other) {return *this;}}; //not a real duration, just satisfy compiler(d1 += d2)
 	struct dummy_time {dummy_duration operator -(const dummy_time& other) {return dummy_duration();}}; //not a real time, just satisfy compiler(t1 - t2)
@@ -298,20 +487,23 @@ struct statistic
 	typedef dummy_time stat_time;
 	static stat_time local_time() {return stat_time();}
 	typedef dummy_duration stat_duration;
+	typedef dummy_duration duration_sum;
+	typedef dummy_duration duration_dist;
 #endif
-	statistic() : send_msg_sum(0), send_byte_sum(0), recv_msg_sum(0), recv_byte_sum(0) {}
 	void reset()
 	{
 		send_msg_sum = send_byte_sum = 0;
-		send_delay_sum = send_time_sum = pack_time_sum = stat_duration();
+		send_delay_sum = duration_dist();
+		send_time_sum = pack_time_sum = duration_sum();
 
 		recv_msg_sum = recv_byte_sum = 0;
-		dispatch_dealy_sum = recv_idle_sum = stat_duration();
+		dispatch_dealy_sum = duration_dist();
+		recv_idle_sum = duration_sum();
 #ifndef ST_ASIO_FORCE_TO_USE_MSG_RECV_BUFFER
-		handle_time_1_sum = stat_duration();
+		handle_time_1_sum = duration_dist();
 #endif
-		handle_time_2_sum = stat_duration();
-		unpack_time_sum = stat_duration();
+		handle_time_2_sum = duration_dist();
+		unpack_time_sum = duration_dist();
 	}
 
 	statistic& operator +=(const struct statistic& other)
@@ -339,25 +531,24 @@ struct statistic
 	{
 		std::ostringstream s;
 #ifdef ST_ASIO_FULL_STATISTIC
-		auto tw = boost::posix_time::time_duration::num_fractional_digits();
-		s << std::setfill('0') << "send corresponding statistic:\n"
+		s << "send corresponding statistic:\n"
 			<< "message sum: " << send_msg_sum << std::endl
 			<< "size in bytes: " << send_byte_sum << std::endl
-			<< "send delay: " << send_delay_sum.total_seconds() << "." << std::setw(tw) << send_delay_sum.fractional_seconds() << std::setw(0) << std::endl
-			<< "send duration: " << send_time_sum.total_seconds() << "." << std::setw(tw) << send_time_sum.fractional_seconds() << std::setw(0) << std::endl
-			<< "pack duration: " << pack_time_sum.total_seconds() << "." << std::setw(tw) << pack_time_sum.fractional_seconds() << std::setw(0) << std::endl
+			<< "send delay: " << duration_to_string(send_delay_sum) << std::endl
+			<< "send duration: " << duration_to_string(send_time_sum) << std::endl
+			<< "pack duration: " << duration_to_string(pack_time_sum) << std::endl
 			<< "\nrecv corresponding statistic:\n"
 			<< "message sum: " << recv_msg_sum << std::endl
 			<< "size in bytes: " << recv_byte_sum << std::endl
-			<< "dispatch delay: " << dispatch_dealy_sum.total_seconds() << "." << std::setw(tw) << dispatch_dealy_sum.fractional_seconds() << std::setw(0) << std::endl
-			<< "recv idle duration: " << recv_idle_sum.total_seconds() << "." << std::setw(tw) << recv_idle_sum.fractional_seconds() << std::setw(0) << std::endl
+			<< "dispatch delay: " << duration_to_string(dispatch_dealy_sum) << std::endl
+			<< "recv idle duration: " << duration_to_string(recv_idle_sum) << std::endl
 #ifndef ST_ASIO_FORCE_TO_USE_MSG_RECV_BUFFER
-			<< "on_msg duration: " << handle_time_1_sum.total_seconds() << "." << std::setw(tw) << handle_time_1_sum.fractional_seconds() << std::setw(0) << std::endl
+			<< "on_msg duration: " << duration_to_string(handle_time_1_sum) << std::endl
 #endif
-			<< "on_msg_handle duration: " << handle_time_2_sum.total_seconds() << "." << std::setw(tw) << handle_time_2_sum.fractional_seconds() << std::endl
-			<< "unpack duration: " << unpack_time_sum.total_seconds() << "." << std::setw(tw) << unpack_time_sum.fractional_seconds();
+			<< "on_msg_handle duration: " << duration_to_string(handle_time_2_sum) << std::endl
+			<< "unpack duration: " << duration_to_string(unpack_time_sum);
 #else
-		s << std::setfill('0') << "send corresponding statistic:\n"
+		s << "send corresponding statistic:\n"
 			<< "message sum: " << send_msg_sum << std::endl
 			<< "size in bytes: " << send_byte_sum << std::endl
 			<< "\nrecv corresponding statistic:\n"
@@ -367,39 +558,59 @@ struct statistic
 		return s.str();
 	}
 
+#ifdef ST_ASIO_FULL_STATISTIC
+	static std::string duration_to_string(const duration_sum& duration)
+	{
+		std::ostringstream s;
+		s << duration.nanoseconds() / 1000000000 << '.' << std::setfill('0') << std::setw(9) << duration.nanoseconds() % 1000000000;
+		return s.str();
+	}
+
+#ifdef ST_ASIO_STAT_HISTOGRAM
+	static std::string duration_to_string(const duration_dist& duration)
+		{return duration_to_string(static_cast<const duration_sum&>(duration)) + " (" + duration.histogram().to_string() + ')';}
+#endif
+#endif
+
 	//send corresponding statistic
-	uint_fast64_t send_msg_sum; //not counted msgs in sending buffer
-	uint_fast64_t send_byte_sum; //not counted msgs in sending buffer
-	stat_duration send_delay_sum; //from send_(native_)msg (exclude msg packing) to asio::async_write
-	stat_duration send_time_sum; //from asio::async_write to send_handler
+	stat_counter send_msg_sum; //not counted msgs in sending buffer
+	stat_counter send_byte_sum; //not counted msgs in sending buffer
+	duration_dist send_delay_sum; //from send_(native_)msg (exclude msg packing) to asio::async_write
+	duration_sum send_time_sum; //from asio::async_write to send_handler
 	//above two items indicate your network's speed or load
-	stat_duration pack_time_sum; //st_udp_socket will not gather this item
+	duration_sum pack_time_sum; //st_udp_socket will not gather this item
 
 	//recv corresponding statistic
-	uint_fast64_t recv_msg_sum; //include msgs in receiving buffer
-	uint_fast64_t recv_byte_sum; //include msgs in receiving buffer
-	stat_duration dispatch_dealy_sum; //from parse_msg(exclude msg unpacking) to on_msg_handle
-	stat_duration recv_idle_sum;
+	stat_counter recv_msg_sum; //include msgs in receiving buffer
+	stat_counter recv_byte_sum; //include msgs in receiving buffer
+	duration_dist dispatch_dealy_sum; //from parse_msg(exclude msg unpacking) to on_msg_handle
+	duration_sum recv_idle_sum;
 	//during this duration, st_socket suspended msg reception (receiving buffer overflow, msg dispatching suspended or doing congestion control)
 #ifndef ST_ASIO_FORCE_TO_USE_MSG_RECV_BUFFER
-	stat_duration handle_time_1_sum; //on_msg consumed time, this indicate the efficiency of msg handling
+	duration_dist handle_time_1_sum; //on_msg consumed time, this indicate the efficiency of msg handling
 #endif
-	stat_duration handle_time_2_sum; //on_msg_handle consumed time, this indicate the efficiency of msg handling
-	stat_duration unpack_time_sum; //st_udp_socket will not gather this item
+	duration_dist handle_time_2_sum; //on_msg_handle consumed time, this indicate the efficiency of msg handling
+	duration_dist unpack_time_sum; //st_udp_socket will not gather this item
 };
 
+//add the duration from construction to end() (or destruction) to a duration_sum or duration_dist of statistic.
 class auto_duration
 {
 public:
-	auto_duration(statistic::stat_duration& duration_) : started(true), begin_time(statistic::local_time()), duration(duration_) {}
+	template<typename Duration>
+	auto_duration(Duration& duration_) : started(true), begin_time(statistic::local_time()), duration(&duration_), add(&auto_duration::add_duration<Duration>) {}
 	~auto_duration() {end();}
 
-	void end() {if (started) duration += statistic::local_time() - begin_time; started = false;}
+	void end() {if (started) add(duration, statistic::local_time() - begin_time); started = false;}
+
+private:
+	template<typename Duration> static void add_duration(void* duration, const statistic::stat_duration& d) {*static_cast<Duration*>(duration) += d;}
 
 private:
 	bool started;
 	statistic::stat_time begin_time;
-	statistic::stat_duration& duration;
+	void* duration;
+	void (*add)(void*, const statistic::stat_duration&);
 };
 
 template<typename T>
@@ -416,6 +627,36 @@ struct obj_with_begin_time : public T
 	typename statistic::stat_time begin_time;
 };
 
+//the type of msgs in st_socket's send buffer, a msg either holds its content itself (like obj_with_begin_time), or shares an immutable msg
+//with other st_sockets (see st_socket::direct_send_shared_msg), so broadcasting (see TCP_SHARED_BROADCAST_MSG) will not copy the msg for every
+//st_socket, even if the msg type is not refcounted (std::string for example). data(), size() and empty() see the shared msg (if any),
+//call materialize() before exposing the msg as T (to on_msg_send for example).
+template<typename T>
+struct shareable_obj_with_begin_time : public obj_with_begin_time<T>
+{
+	typedef obj_with_begin_time<T> super;
+
+	shareable_obj_with_begin_time() {}
+	shareable_obj_with_begin_time(T&& msg) : super(std::move(msg)) {}
+	shareable_obj_with_begin_time(const boost::shared_ptr<const T>& msg) : shared(msg) {}
+
+	bool empty() const {return shared ? shared->empty() : super::empty();}
+	size_t size() const {return shared ? shared->size() : super::size();}
+	const char* data() const {return shared ? shared->data() : super::data();}
+	void clear() {super::clear(); shared.reset();}
+	using super::swap;
+	void swap(shareable_obj_with_begin_time& other) {super::swap(other); shared.swap(other.shared);}
+
+	//copy the shared msg's content into this msg, shared msgs are only created for copyable msg types.
+	void materialize() {if (shared) do_materialize(std::is_copy_constructible<T>());}
+
+	boost::shared_ptr<const T> shared;
+
+private:
+	void do_materialize(std::true_type) {T msg(*shared); shared.reset(); T::swap(msg);}
+	void do_materialize(std::false_type) {assert(false);}
+};
+
 //free functions, used to do something to any container(except map and multimap) optionally with any mutex
 #if !defined _MSC_VER || _MSC_VER >= 1700
 	template<typename _Can, typename _Mutex, typename _Predicate>
@@ -500,11 +741,10 @@ template<typename _Predicate> void NAME(const _Predicate& __pred) const {for (au
 #define SAFE_SEND_MSG_CHECK \
 { \
 	if (!ST_THIS is_send_allowed() || ST_THIS stopped()) return false; \
-	boost::this_thread::sleep(boost::get_system_time() + boost::posix_time::milliseconds(50)); \
+	ST_THIS wait_send_buffer(); \
 }
 
 #define GET_PENDING_MSG_NUM(FUNNAME, CAN) size_t FUNNAME() const {return CAN.size();}
-#define POP_FIRST_PENDING_MSG(FUNNAME, CAN, MSGTYPE) void FUNNAME(MSGTYPE& msg) {msg.clear(); CAN.try_dequeue(msg);}
 #define POP_ALL_PENDING_MSG(FUNNAME, CAN, CANTYPE) void FUNNAME(CANTYPE& msg_queue) {msg_queue.clear(); CAN.swap(msg_queue);}
 
 ///////////////////////////////////////////////////
@@ -531,10 +771,95 @@ TCP_SEND_MSG_CALL_SWITCH(FUNNAME, bool)
 bool FUNNAME(const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false) {while (!SEND_FUNNAME(pstr, len, num, can_overflow)) SAFE_SEND_MSG_CHECK return true;} \
 TCP_SEND_MSG_CALL_SWITCH(FUNNAME, bool)
 
+//never fail and never block, handler (if not empty) will be invoked with true after the msg been put into st_tcp_socket's send buffer,
+//or with false if st_tcp_socket been closed before that, see st_socket::async_direct_send_msg for more details.
+#define TCP_ASYNC_SEND_MSG(FUNNAME, NATIVE) \
+void FUNNAME(const char* const pstr[], const size_t len[], size_t num, const std::function<void(bool)>& handler = std::function<void(bool)>()) \
+{ \
+	auto_duration dur(ST_THIS stat.pack_time_sum); \
+	auto msg = ST_THIS packer_->pack_msg(pstr, len, num, NATIVE); \
+	dur.end(); \
+	ST_THIS async_direct_send_msg(std::move(msg), handler); \
+} \
+void FUNNAME(const char* pstr, size_t len, const std::function<void(bool)>& handler = std::function<void(bool)>()) {FUNNAME(&pstr, &len, 1, handler);} \
+void FUNNAME(const std::string& str, const std::function<void(bool)>& handler = std::function<void(bool)>()) {FUNNAME(str.data(), str.size(), handler);}
+
 #define TCP_BROADCAST_MSG(FUNNAME, SEND_FUNNAME) \
 void FUNNAME(const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false) \
 	{ST_THIS do_something_to_all([=](typename Pool::object_ctype& item) {item->SEND_FUNNAME(pstr, len, num, can_overflow);});} \
 TCP_SEND_MSG_CALL_SWITCH(FUNNAME, void)
+
+//get the packer of any st_socket (so all st_sockets must use the same protocol) for the broadcast macros below, the pool is only locked
+//while fetching the packer, packing happens after that, in the calling thread.
+#define TCP_GET_BROADCAST_PACKER(PACKER) \
+boost::shared_ptr<i_packer<typename Socket::in_msg_type>> PACKER; \
+ST_THIS do_something_to_one([&](typename Pool::object_ctype& item) {PACKER = item->inner_packer(); return true;})
+
+//pack the msg only once (outside the pool's lock), then share the packed msg (immutable from now on) among all st_sockets' send buffer
+//via direct_send_shared_msg, no matter what the packer's msg type is (std::string, shared_buffer or slab_buffer), its content will not be copied.
+#define TCP_SHARED_BROADCAST_MSG(FUNNAME, NATIVE) \
+void FUNNAME(const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false) \
+{ \
+	TCP_GET_BROADCAST_PACKER(packer); \
+	if (packer) \
+		direct_broadcast_shared_msg(boost::make_shared<const typename Socket::in_msg_type>(packer->pack_msg(pstr, len, num, NATIVE)), can_overflow); \
+} \
+TCP_SEND_MSG_CALL_SWITCH(FUNNAME, void)
+
+//put a packed msg into all st_sockets' send buffer, the msg will be copied only once, see TCP_SHARED_BROADCAST_MSG for more details.
+#define TCP_DIRECT_BROADCAST_MSG(FUNNAME) \
+void FUNNAME(typename Socket::in_msg_ctype& msg, bool can_overflow = false) \
+	{if (!msg.empty()) direct_broadcast_shared_msg(boost::make_shared<const typename Socket::in_msg_type>(msg), can_overflow);} \
+void direct_broadcast_shared_msg(const boost::shared_ptr<const typename Socket::in_msg_type>& msg, bool can_overflow) \
+	{if (msg && !msg->empty()) ST_THIS do_something_to_all([&](typename Pool::object_ctype& item) {item->direct_send_shared_msg(msg, can_overflow);});}
+
+//like TCP_SHARED_BROADCAST_MSG, but only send the msg to st_sockets in the specified group (see st_object_pool::join_group).
+#define TCP_GROUP_SEND_MSG(FUNNAME, NATIVE) \
+void FUNNAME(const std::string& group, const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false) \
+{ \
+	TCP_GET_BROADCAST_PACKER(packer); \
+	if (packer) \
+		direct_group_send_shared_msg(group, boost::make_shared<const typename Socket::in_msg_type>(packer->pack_msg(pstr, len, num, NATIVE)), can_overflow); \
+} \
+void FUNNAME(const std::string& group, const char* pstr, size_t len, bool can_overflow = false) {FUNNAME(group, &pstr, &len, 1, can_overflow);} \
+void FUNNAME(const std::string& group, const std::string& str, bool can_overflow = false) {FUNNAME(group, str.data(), str.size(), can_overflow);}
+
+//put a packed msg into the send buffer of st_sockets in the specified group, the msg will be copied only once.
+#define TCP_DIRECT_GROUP_SEND_MSG(FUNNAME) \
+void FUNNAME(const std::string& group, typename Socket::in_msg_ctype& msg, bool can_overflow = false) \
+	{if (!msg.empty()) direct_group_send_shared_msg(group, boost::make_shared<const typename Socket::in_msg_type>(msg), can_overflow);} \
+void direct_group_send_shared_msg(const std::string& group, const boost::shared_ptr<const typename Socket::in_msg_type>& msg, bool can_overflow) \
+	{if (msg && !msg->empty()) ST_THIS do_something_to_group(group, [&](typename Pool::object_ctype& item) {item->direct_send_shared_msg(msg, can_overflow);});}
+
+//like TCP_SHARED_BROADCAST_MSG, but put the packed msg into st_sockets' send buffer in service threads concurrently (see st_object_pool::do_something_to_all_async),
+//this function returns immediately after the msg been packed, done (if not empty) will be invoked after the msg been put into all st_sockets' send buffer
+//(in a service thread, or in the calling thread if there's nothing to broadcast), st_sockets that are added during the broadcast will not receive the msg.
+//successive parallel broadcasts may reach a st_socket out of order, if the order matters, start the next broadcast in done.
+#define TCP_PARALLEL_BROADCAST_MSG(FUNNAME, NATIVE) \
+void FUNNAME(const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false, const std::function<void()>& done = std::function<void()>()) \
+{ \
+	TCP_GET_BROADCAST_PACKER(packer); \
+	if (packer) \
+		parallel_direct_broadcast_shared_msg(boost::make_shared<const typename Socket::in_msg_type>(packer->pack_msg(pstr, len, num, NATIVE)), can_overflow, done); \
+	else if (done) \
+		done(); \
+} \
+void FUNNAME(const char* pstr, size_t len, bool can_overflow = false, const std::function<void()>& done = std::function<void()>()) \
+	{FUNNAME(&pstr, &len, 1, can_overflow, done);} \
+void FUNNAME(const std::string& str, bool can_overflow = false, const std::function<void()>& done = std::function<void()>()) \
+	{FUNNAME(str.data(), str.size(), can_overflow, done);}
+
+//put a packed msg into all st_sockets' send buffer in service threads concurrently, see TCP_PARALLEL_BROADCAST_MSG for more details.
+#define TCP_PARALLEL_DIRECT_BROADCAST_MSG(FUNNAME) \
+void FUNNAME(typename Socket::in_msg_ctype& msg, bool can_overflow = false, const std::function<void()>& done = std::function<void()>()) \
+	{parallel_direct_broadcast_shared_msg(boost::make_shared<const typename Socket::in_msg_type>(msg), can_overflow, done);} \
+void parallel_direct_broadcast_shared_msg(const boost::shared_ptr<const typename Socket::in_msg_type>& msg, bool can_overflow, const std::function<void()>& done) \
+{ \
+	if (msg && !msg->empty()) \
+		ST_THIS do_something_to_all_async([=](typename Pool::object_ctype& item) {item->direct_send_shared_msg(msg, can_overflow);}, done); \
+	else if (done) \
+		done(); \
+}
 //TCP msg sending interface
 ///////////////////////////////////////////////////
 
@@ -560,6 +885,19 @@ UDP_SEND_MSG_CALL_SWITCH(FUNNAME, bool)
 bool FUNNAME(const boost::asio::ip::udp::endpoint& peer_addr, const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false) \
 	{while (!SEND_FUNNAME(peer_addr, pstr, len, num, can_overflow)) SAFE_SEND_MSG_CHECK return true;} \
 UDP_SEND_MSG_CALL_SWITCH(FUNNAME, bool)
+
+//never fail and never block, see TCP_ASYNC_SEND_MSG for more details.
+#define UDP_ASYNC_SEND_MSG(FUNNAME, NATIVE) \
+void FUNNAME(const boost::asio::ip::udp::endpoint& peer_addr, const char* const pstr[], const size_t len[], size_t num, \
+	const std::function<void(bool)>& handler = std::function<void(bool)>()) \
+{ \
+	in_msg_type msg(peer_addr, ST_THIS packer_->pack_msg(pstr, len, num, NATIVE)); \
+	ST_THIS async_direct_send_msg(std::move(msg), handler); \
+} \
+void FUNNAME(const boost::asio::ip::udp::endpoint& peer_addr, const char* pstr, size_t len, const std::function<void(bool)>& handler = std::function<void(bool)>()) \
+	{FUNNAME(peer_addr, &pstr, &len, 1, handler);} \
+void FUNNAME(const boost::asio::ip::udp::endpoint& peer_addr, const std::string& str, const std::function<void(bool)>& handler = std::function<void(bool)>()) \
+	{FUNNAME(peer_addr, str.data(), str.size(), handler);}
 //UDP msg sending interface
 ///////////////////////////////////////////////////
 
@@ -47,6 +47,128 @@ public:
 };
 #endif
 
+//contiguous circular buffer, it only allocates memory when it needs to grow (capacity doubles every time), popped slots will be reused,
+//so in steady state, pushing and popping items cause no memory allocations at all (not counting the items themselves).
+//it can be used as the container of input and output queues:
+// #define ST_ASIO_INPUT_CONTAINER ring_buffer
+// #define ST_ASIO_OUTPUT_CONTAINER ring_buffer
+//splice only support appending items to the end (what st_socket needs), items will be moved but not copied.
+//Container(size_t) means reserve space for this number of items, not like list, no items will be created.
+template<typename T>
+class ring_buffer
+{
+protected:
+	template<typename Value, typename Buffer>
+	class iterator_base
+	{
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef Value value_type;
+		typedef ptrdiff_t difference_type;
+		typedef Value* pointer;
+		typedef Value& reference;
+
+		iterator_base() : buffer(nullptr), index(0) {}
+		iterator_base(Buffer* buffer_, size_t index_) : buffer(buffer_), index(index_) {}
+		template<typename V, typename B> iterator_base(const iterator_base<V, B>& other) : buffer(other.buffer), index(other.index) {}
+
+		Value& operator*() const {return buffer->at(index);}
+		Value* operator->() const {return &buffer->at(index);}
+		iterator_base& operator++() {++index; return *this;}
+		iterator_base operator++(int) {auto tmp = *this; ++index; return tmp;}
+		iterator_base& operator--() {--index; return *this;}
+		iterator_base operator--(int) {auto tmp = *this; --index; return tmp;}
+		template<typename V, typename B> bool operator==(const iterator_base<V, B>& other) const {return index == other.index && buffer == other.buffer;}
+		template<typename V, typename B> bool operator!=(const iterator_base<V, B>& other) const {return !(*this == other);}
+
+	private:
+		template<typename V, typename B> friend class iterator_base;
+		Buffer* buffer;
+		size_t index; //logical index, 0 means front
+	};
+
+public:
+	typedef T value_type;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef iterator_base<T, ring_buffer> iterator;
+	typedef iterator_base<const T, const ring_buffer> const_iterator;
+
+	ring_buffer() : buff(nullptr), capacity_(0), first(0), size_(0) {}
+	ring_buffer(size_t size) : buff(nullptr), capacity_(0), first(0), size_(0) {reserve(size);}
+	ring_buffer(ring_buffer&& other) : buff(nullptr), capacity_(0), first(0), size_(0) {swap(other);}
+	ring_buffer(const ring_buffer& other) : buff(nullptr), capacity_(0), first(0), size_(0) {reserve(other.size_); for (auto& item : other) push_back(item);}
+	~ring_buffer() {clear(); ::operator delete(buff);}
+
+	ring_buffer& operator=(ring_buffer&& other) {clear(); swap(other); return *this;}
+	ring_buffer& operator=(const ring_buffer& other) {if (this != &other) {clear(); reserve(other.size_); for (auto& item : other) push_back(item);} return *this;}
+
+	size_t size() const {return size_;}
+	bool empty() const {return 0 == size_;}
+	size_t capacity() const {return capacity_;}
+	void clear() {while (!empty()) pop_front();} //keep the memory for reusing
+	void swap(ring_buffer& other) {std::swap(buff, other.buff); std::swap(capacity_, other.capacity_); std::swap(first, other.first); std::swap(size_, other.size_);}
+	void reserve(size_t size) {if (size > capacity_) grow(size);}
+	//give back all memory
+	void shrink_to_fit() {if (empty()) {::operator delete(buff); buff = nullptr; capacity_ = first = 0;}}
+
+	iterator begin() {return iterator(this, 0);}
+	iterator end() {return iterator(this, size_);}
+	const_iterator begin() const {return const_iterator(this, 0);}
+	const_iterator end() const {return const_iterator(this, size_);}
+
+	T& at(size_t index) {assert(index < size_); return buff[(first + index) & (capacity_ - 1)];}
+	const T& at(size_t index) const {assert(index < size_); return buff[(first + index) & (capacity_ - 1)];}
+	T& front() {return at(0);}
+	const T& front() const {return at(0);}
+	T& back() {return at(size_ - 1);}
+	const T& back() const {return at(size_ - 1);}
+
+	void push_back(const T& item) {new (alloc_back()) T(item); ++size_;}
+	void push_back(T&& item) {new (alloc_back()) T(std::move(item)); ++size_;}
+	void pop_front() {assert(!empty()); front().~T(); first = (first + 1) & (capacity_ - 1); --size_;}
+	void resize(size_t size) {while (size_ > size) pop_back(); reserve(size); while (size_ < size) {new (alloc_back()) T(); ++size_;}}
+	void pop_back() {assert(!empty()); back().~T(); --size_;}
+
+	//only support appending items to the end, after this, src_can will be empty.
+	template<typename Can>
+	void splice(const_iterator pos, Can& src_can)
+	{
+		assert(pos == end());
+		reserve(size_ + src_can.size());
+		for (auto& item : src_can)
+			push_back(std::move(item));
+		src_can.clear();
+	}
+
+private:
+	T* alloc_back() {if (size_ == capacity_) grow(size_ + 1); return &buff[(first + size_) & (capacity_ - 1)];}
+	void grow(size_t size)
+	{
+		size_t new_capacity = 0 == capacity_ ? 16 : capacity_;
+		while (new_capacity < size)
+			new_capacity <<= 1;
+
+		auto new_buff = (T*) ::operator new(new_capacity * sizeof(T));
+		for (size_t i = 0; i < size_; ++i)
+		{
+			auto& item = at(i);
+			new (&new_buff[i]) T(std::move(item));
+			item.~T();
+		}
+		::operator delete(buff);
+
+		buff = new_buff;
+		capacity_ = new_capacity; //always be power of 2
+		first = 0;
+	}
+
+private:
+	T* buff;
+	size_t capacity_, first, size_;
+};
+
 class dummy_lockable
 {
 public:
@@ -81,6 +203,7 @@ private:
 // splice(Container::const_iterator, std::list<T>&), after this, std::list<T> must be empty
 // front
 // pop_front
+//T must has size() function, queues account the total size (in bytes) of their items, see size_in_byte().
 template<typename T, typename Container, typename Lockable>
 class queue : public Container, public Lockable
 {
@@ -89,20 +212,134 @@ public:
 	typedef Container super;
 	typedef queue<T, Container, Lockable> me;
 
-	queue() {}
-	queue(size_t size) : super(size) {}
+	queue() : buff_size(0) {}
+	queue(size_t size) : super(size), buff_size(0) {}
+
+	//can be called in any thread, but it's not synchronized with other operations (as size()).
+	size_t size_in_byte() const {return buff_size;}
+	void clear() {super::clear(); buff_size = 0;}
+	void swap(me& other) {super::swap(other); size_t size = buff_size; buff_size = (size_t) other.buff_size; other.buff_size = size;}
 
 	bool enqueue(const T& item) {typename Lockable::lock_guard lock(*this); return enqueue_(item);}
 	bool enqueue(T&& item) {typename Lockable::lock_guard lock(*this); return enqueue_(std::move(item));}
 	void move_items_in(boost::container::list<T>& can) {typename Lockable::lock_guard lock(*this); move_items_in_(can);}
 	bool try_dequeue(T& item) {typename Lockable::lock_guard lock(*this); return try_dequeue_(item);}
 
-	bool enqueue_(const T& item) {this->push_back(item); return true;}
-	bool enqueue_(T&& item) {this->push_back(std::move(item)); return true;}
-	void move_items_in_(boost::container::list<T>& can) {this->splice(std::end(*this), can);}
-	bool try_dequeue_(T& item) {if (this->empty()) return false; item.swap(this->front()); this->pop_front(); return true;}
+	bool enqueue_(const T& item) {this->push_back(item); buff_size += item.size(); return true;}
+	bool enqueue_(T&& item) {buff_size += item.size(); this->push_back(std::move(item)); return true;}
+	void move_items_in_(boost::container::list<T>& can)
+	{
+		size_t size = 0;
+		for (auto iter = std::begin(can); iter != std::end(can); ++iter)
+			size += iter->size();
+		this->splice(std::end(*this), can);
+		buff_size += size;
+	}
+	bool try_dequeue_(T& item) {if (this->empty()) return false; item.swap(this->front()); this->pop_front(); buff_size -= item.size(); return true;}
+
+private:
+	st_atomic_size_t buff_size;
 };
 
+#if BOOST_VERSION >= 105300
+//multiple producers single consumer lock-free queue (non-intrusive variant of Dmitry Vyukov's MPSC node-based queue).
+//enqueue, enqueue_ and move_items_in can be called concurrently in any threads (wait-free, one exchange per item),
+//try_dequeue, try_dequeue_, clear and swap can only be called in one thread at any time, st_socket guarantees this for the sending buffer
+//(do_send_msg will never be invoked concurrently), so you can use it as the input queue when send_msg is called concurrently in many threads:
+// #define ST_ASIO_INPUT_QUEUE lock_free_queue
+//
+//the Container argument is not used, it's only there to satisfy st_socket's InQueue<T, InContainer<T>> requirement.
+//lock_guard is a dummy lock, so all xxx_ (un-locked) functions are equivalent to their locked versions.
+//
+//a producer exchanges head first, then links its node to the previous one and counts the item, so with multiple producers, a counted item
+//may be temporarily unreachable: if producer A has exchanged head but not yet linked its node while producer B (exchanged after A) has linked
+//and counted, try_dequeue_ stops at A's unlinked node even though size() > 0. also, if the consumer takes an item before it been counted,
+//the counter goes below zero for a while (empty() returns true, size() returns 0). so empty() and size() are only hints, the real invariant
+//is: every producer invokes send_msg() after counting its item, so an item which was unreachable or uncounted when the consumer looked will
+//always be dequeued by a later sending, this is what st_socket (send_handler) relies on, nothing will be stranded.
+//notice: st_socket's pop_first_pending_send_msg and pop_all_pending_send_msg dequeue in the calling thread, which makes it a second consumer,
+//so do not call them when using lock_free_queue as the sending buffer, unless sending has been suspended and no sending is in progress.
+template<typename T, typename Container>
+class lock_free_queue : public dummy_lockable, public boost::noncopyable
+{
+protected:
+	struct node
+	{
+		node() : next(nullptr) {}
+		node(const T& item_) : item(item_), next(nullptr) {}
+		node(T&& item_) : item(std::move(item_)), next(nullptr) {}
+
+		T item;
+		boost::atomic<node*> next;
+	};
+
+public:
+	typedef T data_type;
+	typedef lock_free_queue<T, Container> me;
+
+	lock_free_queue() : head(new node()), item_num(0), buff_size(0) {tail = head.load(boost::memory_order_relaxed);}
+	lock_free_queue(size_t) : head(new node()), item_num(0), buff_size(0) {tail = head.load(boost::memory_order_relaxed);}
+	~lock_free_queue() {clear(); delete tail;}
+
+	size_t size() const {return positive(item_num);}
+	size_t size_in_byte() const {return positive(buff_size);}
+	bool empty() const {return 0 == size();}
+	//consumer only
+	void clear() {T item; while (try_dequeue_(item)) item.clear();}
+	//consumer only (for both this and other), not atomic, items enqueued concurrently will end up in either queue.
+	void swap(me& other)
+	{
+		boost::container::list<T> can, other_can;
+		T item;
+		while (try_dequeue_(item)) {can.resize(can.size() + 1); can.back().swap(item);}
+		while (other.try_dequeue_(item)) {other_can.resize(other_can.size() + 1); other_can.back().swap(item);}
+		move_items_in_(other_can);
+		other.move_items_in_(can);
+	}
+
+	bool enqueue(const T& item) {return enqueue_(item);}
+	bool enqueue(T&& item) {return enqueue_(std::move(item));}
+	void move_items_in(boost::container::list<T>& can) {move_items_in_(can);}
+	bool try_dequeue(T& item) {return try_dequeue_(item);}
+
+	bool enqueue_(const T& item) {push(new node(item)); return true;}
+	bool enqueue_(T&& item) {push(new node(std::move(item))); return true;}
+	void move_items_in_(boost::container::list<T>& can) {for (auto& item : can) push(new node(std::move(item))); can.clear();}
+	bool try_dequeue_(T& item)
+	{
+		auto next = tail->next.load(boost::memory_order_acquire);
+		if (nullptr == next)
+			return false;
+
+		item.swap(next->item); //next becomes the new stub, its item will be destroyed with it
+		delete tail;
+		tail = next;
+		--item_num;
+		buff_size -= item.size();
+
+		return true;
+	}
+
+private:
+	//the counters are signed in fact, see the class comment
+	static size_t positive(size_t value) {return (ptrdiff_t) value > 0 ? value : 0;}
+
+	void push(node* n)
+	{
+		auto size = n->item.size(); //n may be consumed right after been linked
+		auto prev = head.exchange(n, boost::memory_order_acq_rel);
+		prev->next.store(n, boost::memory_order_release);
+		++item_num; //count after linking, so empty() will not return false before the item becomes available to the consumer
+		buff_size += size;
+	}
+
+private:
+	boost::atomic<node*> head; //producers side
+	node* tail; //consumer side, always points to the stub
+	st_atomic_size_t item_num, buff_size;
+};
+#endif
+
 #if !defined(_MSC_VER) || _MSC_VER >= 1800
 template<typename T, typename Container> using non_lock_queue = queue<T, Container, dummy_lockable>; //totally not thread safe
 template<typename T, typename Container> using lock_queue = queue<T, Container, lockable>;
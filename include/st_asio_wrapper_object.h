@@ -15,9 +15,88 @@
 
 #include "st_asio_wrapper_base.h"
 
+//if ST_ASIO_DELAY_CLOSE equal to zero, handlers of async calls (receiving, sending, timers, etc.) will be allocated from
+//ST_ASIO_HANDLER_MEMORY_NUM memory slots (each has ST_ASIO_HANDLER_MEMORY_SIZE bytes) owned by st_object via asio's handler allocation hooks,
+//handlers that are bigger than one slot, or when all slots are occupied, will be allocated from the heap as usual.
+#ifndef ST_ASIO_HANDLER_MEMORY_SIZE
+#define ST_ASIO_HANDLER_MEMORY_SIZE	256
+#endif
+static_assert(ST_ASIO_HANDLER_MEMORY_SIZE > 0, "handler memory size must be bigger than zero.");
+
+#ifndef ST_ASIO_HANDLER_MEMORY_NUM
+#define ST_ASIO_HANDLER_MEMORY_NUM	4 //one for receiving, one for sending, others for timers, connecting and post()
+#endif
+static_assert(ST_ASIO_HANDLER_MEMORY_NUM > 0, "handler memory number must be bigger than zero.");
+
 namespace st_asio_wrapper
 {
 
+#if 0 == ST_ASIO_DELAY_CLOSE
+class handler_memory : public boost::noncopyable
+{
+public:
+	void* allocate(size_t size)
+	{
+		if (size <= ST_ASIO_HANDLER_MEMORY_SIZE)
+		{
+			for (size_t i = 0; i < ST_ASIO_HANDLER_MEMORY_NUM; ++i)
+				if (1 == ++slots[i].used) //deallocate() will release it
+					return &slots[i].storage;
+				else
+					--slots[i].used;
+		}
+
+		return ::operator new(size);
+	}
+
+	void deallocate(void* p)
+	{
+		for (size_t i = 0; i < ST_ASIO_HANDLER_MEMORY_NUM; ++i)
+			if (p == &slots[i].storage)
+			{
+				--slots[i].used;
+				return;
+			}
+
+		::operator delete(p);
+	}
+
+private:
+	struct slot
+	{
+		slot() : used(0) {}
+
+		std::aligned_storage<ST_ASIO_HANDLER_MEMORY_SIZE>::type storage;
+		st_atomic_size_t used;
+	};
+
+	slot slots[ST_ASIO_HANDLER_MEMORY_NUM];
+};
+
+//wrap a handler of an async call, it keeps a reference of st_object's async_call_indicator (to count this async call),
+//and asks asio to allocate memory (for the async operation which holds it) from st_object's handler_memory.
+//it's small and concrete, so no std::function (type erasure and heap allocation) is involved, and asio moves it (rather than copies it),
+//so the reference count of async_call_indicator only be increased once and decreased once per async call.
+template<typename F>
+class async_handler
+{
+public:
+	async_handler(handler_memory& memory_, const boost::shared_ptr<char>& indicator_, const F& handler_) : memory(&memory_), indicator(indicator_), handler(handler_) {}
+
+	void operator()() {handler();}
+	void operator()(const boost::system::error_code& ec) {handler(ec);}
+	void operator()(const boost::system::error_code& ec, size_t bytes_transferred) {handler(ec, bytes_transferred);}
+
+	friend void* asio_handler_allocate(size_t size, async_handler* this_handler) {return this_handler->memory->allocate(size);}
+	friend void asio_handler_deallocate(void* p, size_t, async_handler* this_handler) {this_handler->memory->deallocate(p);}
+
+private:
+	handler_memory* memory; //must keep unchanged after been moved, because asio will deallocate memory via the moved-from handler
+	boost::shared_ptr<char> indicator;
+	F handler;
+};
+#endif
+
 class st_object
 {
 protected:
@@ -26,16 +105,13 @@ protected:
 
 public:
 	bool stopped() const {return io_service_.stopped();}
+	boost::asio::io_service& get_io_service() {return io_service_;}
 
 #if 0 == ST_ASIO_DELAY_CLOSE
-	template<typename F> void post(const F& handler) {auto unused(async_call_indicator); io_service_.post([=]() {handler();});}
-
-	typedef std::function<void(const boost::system::error_code&)> handler_with_error;
-	template<typename F> handler_with_error make_handler_error(const F& handler) const {auto unused(async_call_indicator); return [=](const boost::system::error_code& ec) {handler(ec);};}
+	template<typename F> void post(const F& handler) {io_service_.post(make_handler(handler));}
 
-	typedef std::function<void(const boost::system::error_code&, size_t)> handler_with_error_size;
-	template<typename F> handler_with_error_size make_handler_error_size(const F& handler) const
-		{auto unused(async_call_indicator); return [=](const boost::system::error_code& ec, size_t bytes_transferred) {handler(ec, bytes_transferred);};}
+	template<typename F> async_handler<F> make_handler_error(const F& handler) const {return make_handler(handler);}
+	template<typename F> async_handler<F> make_handler_error_size(const F& handler) const {return make_handler(handler);}
 
 	bool is_async_calling() const {return !async_call_indicator.unique();}
 	bool is_last_async_call() const {return async_call_indicator.use_count() <= 2;} //can only be called in callbacks
@@ -43,9 +119,11 @@ public:
 
 protected:
 	void reset() {async_call_indicator = boost::make_shared<char>('\0');}
+	template<typename F> async_handler<F> make_handler(const F& handler) const {return async_handler<F>(handler_memory_, async_call_indicator, handler);}
 
 protected:
 	boost::shared_ptr<char> async_call_indicator;
+	mutable handler_memory handler_memory_; //asio allocates memory from it via a const st_object (see make_handler_error)
 #else
 	template<typename F> void post(F&& handler) {io_service_.post(std::move(handler));}
 	template<typename F> void post(const F& handler) {io_service_.post(handler);}
@@ -14,7 +14,10 @@
 #ifndef ST_ASIO_WRAPPER_OBJECT_POOL_H_
 #define ST_ASIO_WRAPPER_OBJECT_POOL_H_
 
+#include <vector>
+#include <boost/array.hpp>
 #include <boost/unordered_set.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "st_asio_wrapper_timer.h"
 #include "st_asio_wrapper_service_pump.h"
@@ -27,12 +30,32 @@ static_assert(ST_ASIO_MAX_OBJECT_NUM > 0, "object capacity must be bigger than z
 //define ST_ASIO_REUSE_OBJECT macro will enable object pool, all objects in invalid_object_can will never be freed, but kept for reusing,
 //otherwise, st_object_pool will free objects in invalid_object_can automatically and periodically, ST_ASIO_FREE_OBJECT_INTERVAL means the interval, unit is second,
 //see invalid_object_can at the end of st_object_pool class for more details.
+//if object pool been enabled, st_object_pool will move reusable objects from invalid_object_can to reusable_object_can automatically and periodically,
+//ST_ASIO_COLLECT_OBJECT_INTERVAL means the interval, unit is second, so reusing an object is O(1).
+//each collection probes at most ST_ASIO_COLLECT_OBJECT_NUM objects (continue from where the last collection stopped), and if reusable_object_can
+//is empty, reuse_object() will probe at most ST_ASIO_REUSE_OBJECT_PROBE_NUM objects by itself, so a burst of connections can reuse objects before the next collection.
 #ifndef ST_ASIO_REUSE_OBJECT
 	#ifndef ST_ASIO_FREE_OBJECT_INTERVAL
 	#define ST_ASIO_FREE_OBJECT_INTERVAL	60 //seconds
 	#elif ST_ASIO_FREE_OBJECT_INTERVAL <= 0
 		#error free object interval must be bigger than zero.
 	#endif
+#else
+	#ifndef ST_ASIO_COLLECT_OBJECT_INTERVAL
+	#define ST_ASIO_COLLECT_OBJECT_INTERVAL	1 //seconds
+	#elif ST_ASIO_COLLECT_OBJECT_INTERVAL <= 0
+		#error collect object interval must be bigger than zero.
+	#endif
+
+	#ifndef ST_ASIO_COLLECT_OBJECT_NUM
+	#define ST_ASIO_COLLECT_OBJECT_NUM	1024
+	#endif
+	static_assert(ST_ASIO_COLLECT_OBJECT_NUM > 0, "the number of objects probed per collection must be bigger than zero.");
+
+	#ifndef ST_ASIO_REUSE_OBJECT_PROBE_NUM
+	#define ST_ASIO_REUSE_OBJECT_PROBE_NUM	16
+	#endif
+	static_assert(ST_ASIO_REUSE_OBJECT_PROBE_NUM > 0, "the number of objects probed by reuse_object must be bigger than zero.");
 #endif
 
 //define ST_ASIO_CLEAR_OBJECT_INTERVAL macro to let st_object_pool to invoke clear_obsoleted_object() automatically and periodically
@@ -44,6 +67,19 @@ static_assert(ST_ASIO_MAX_OBJECT_NUM > 0, "object capacity must be bigger than z
 	#error clear object interval must be bigger than zero.
 #endif
 
+//how many shards st_sharded_object_pool has, each shard has its own container and mutex.
+#ifndef ST_ASIO_OBJECT_POOL_SHARD_NUM
+#define ST_ASIO_OBJECT_POOL_SHARD_NUM	16
+#endif
+static_assert(ST_ASIO_OBJECT_POOL_SHARD_NUM > 0, "shard number must be bigger than zero.");
+
+//do_something_to_all_async splits the snapshot of all objects into parts, each part has at most ST_ASIO_ASYNC_TRAVERSE_PART_SIZE objects,
+//and will be traversed in one posted handler.
+#ifndef ST_ASIO_ASYNC_TRAVERSE_PART_SIZE
+#define ST_ASIO_ASYNC_TRAVERSE_PART_SIZE	1024
+#endif
+static_assert(ST_ASIO_ASYNC_TRAVERSE_PART_SIZE > 0, "the size of traversing part must be bigger than zero.");
+
 namespace st_asio_wrapper
 {
 
@@ -75,14 +111,21 @@ protected:
 	static const tid TIMER_BEGIN = st_timer::TIMER_END;
 	static const tid TIMER_FREE_SOCKET = TIMER_BEGIN;
 	static const tid TIMER_CLEAR_SOCKET = TIMER_BEGIN + 1;
+	static const tid TIMER_COLLECT_SOCKET = TIMER_BEGIN + 2;
 	static const tid TIMER_END = TIMER_BEGIN + 10;
 
-	st_object_pool(st_service_pump& service_pump_) : i_service(service_pump_), st_timer(service_pump_), cur_id(-1), max_size_(ST_ASIO_MAX_OBJECT_NUM) {}
+	st_object_pool(st_service_pump& service_pump_) : i_service(service_pump_), st_timer(service_pump_), cur_id(-1), max_size_(ST_ASIO_MAX_OBJECT_NUM)
+#ifdef ST_ASIO_REUSE_OBJECT
+		, collect_bucket(0)
+#endif
+		{}
 
 	void start()
 	{
 #ifndef ST_ASIO_REUSE_OBJECT
 		set_timer(TIMER_FREE_SOCKET, 1000 * ST_ASIO_FREE_OBJECT_INTERVAL, [this](tid id)->bool {ST_THIS free_object(); return true;});
+#else
+		set_timer(TIMER_COLLECT_SOCKET, 1000 * ST_ASIO_COLLECT_OBJECT_INTERVAL, [this](tid id)->bool {ST_THIS collect_reusable_object(); return true;});
 #endif
 #ifdef ST_ASIO_CLEAR_OBJECT_INTERVAL
 		set_timer(TIMER_CLEAR_SOCKET, 1000 * ST_ASIO_CLEAR_OBJECT_INTERVAL, [this](tid id)->bool {ST_THIS clear_obsoleted_object(); return true;});
@@ -99,20 +142,22 @@ protected:
 		return object_can.size() < max_size_ ? object_can.insert(object_ptr).second : false;
 	}
 
-	//only add object_ptr to invalid_object_can when it's in object_can, this can avoid duplicated items in invalid_object_can, because invalid_object_can is a list,
-	//there's no way to check the existence of an item in a list efficiently.
+	//only add object_ptr to invalid_object_can when it's in object_can, this can avoid adding an object which is in reusable_object_can to invalid_object_can again.
+	//leave all groups before releasing object_can_mutex, so object_ptr can not join any group again (see join_group).
 	bool del_object(object_ctype& object_ptr)
 	{
 		assert(object_ptr);
 
 		boost::unique_lock<boost::shared_mutex> lock(object_can_mutex);
 		auto exist = object_can.erase(object_ptr) > 0;
+		if (exist)
+			leave_all_group(object_ptr);
 		lock.unlock();
 
 		if (exist)
 		{
 			boost::unique_lock<boost::shared_mutex> lock(invalid_object_can_mutex);
-			invalid_object_can.push_back(object_ptr);
+			invalid_object_can.insert(object_ptr);
 		}
 
 		return exist;
@@ -132,23 +177,71 @@ protected:
 	}
 
 #ifdef ST_ASIO_REUSE_OBJECT
+	//O(1) in most cases, objects only become reusable after they have been moved into reusable_object_can, if reusable_object_can is empty,
+	//at most ST_ASIO_REUSE_OBJECT_PROBE_NUM objects in invalid_object_can will be probed.
 	object_type reuse_object()
 	{
 		boost::unique_lock<boost::shared_mutex> lock(invalid_object_can_mutex);
-		for (auto iter = std::begin(invalid_object_can); iter != std::end(invalid_object_can); ++iter)
-			if ((*iter).unique() && (*iter)->obsoleted())
+		if (reusable_object_can.empty())
+			do_collect_reusable_object(ST_ASIO_REUSE_OBJECT_PROBE_NUM);
+
+		while (!reusable_object_can.empty())
+		{
+			auto object_ptr(std::move(reusable_object_can.front()));
+			reusable_object_can.pop_front();
+			if (object_ptr.unique() && object_ptr->obsoleted())
 			{
-				auto object_ptr(std::move(*iter));
-				invalid_object_can.erase(iter);
 				lock.unlock();
 
+				leave_all_group(object_ptr); //before its id been changed, so it will never receive its previous incarnation's group traffic
 				object_ptr->reset();
 				return object_ptr;
 			}
 
+			invalid_object_can.insert(object_ptr); //been referenced again (by invalid_object_find for example), wait for the next collection
+		}
+
 		return object_type();
 	}
 
+	//move reusable objects from invalid_object_can to reusable_object_can, probe at most max_num objects,
+	//st_object_pool will invoke this function automatically and periodically (see ST_ASIO_COLLECT_OBJECT_INTERVAL macro).
+	size_t collect_reusable_object(size_t max_num = ST_ASIO_COLLECT_OBJECT_NUM)
+	{
+		boost::unique_lock<boost::shared_mutex> lock(invalid_object_can_mutex);
+		return do_collect_reusable_object(max_num);
+	}
+
+private:
+	//invalid_object_can_mutex must be locked exclusively, walk invalid_object_can bucket by bucket, start from collect_bucket,
+	//so successive calls will cover all objects without scanning the whole container every time.
+	size_t do_collect_reusable_object(size_t max_num)
+	{
+		size_t num_affected = 0;
+		auto bucket_num = invalid_object_can.bucket_count();
+		for (size_t i = 0; max_num > 0 && i < bucket_num && !invalid_object_can.empty(); ++i)
+		{
+			if (collect_bucket >= bucket_num)
+				collect_bucket = 0;
+
+			for (auto iter = invalid_object_can.begin(collect_bucket); max_num > 0 && iter != invalid_object_can.end(collect_bucket); --max_num)
+				if ((*iter).unique() && (*iter)->obsoleted())
+				{
+					++num_affected;
+					reusable_object_can.push_back(*iter++);
+					invalid_object_can.erase(reusable_object_can.back()); //only invalidate the erased one
+				}
+				else
+					++iter;
+
+			if (max_num > 0) //this bucket has been finished
+				++collect_bucket;
+		}
+
+		return num_affected;
+	}
+
+protected:
 	template<typename Arg>
 	object_type create_object(Arg& arg)
 	{
@@ -203,10 +296,15 @@ public:
 		return object_can.size();
 	}
 
+	//include objects in reusable_object_can
 	size_t invalid_object_size()
 	{
 		boost::shared_lock<boost::shared_mutex> lock(invalid_object_can_mutex);
+#ifdef ST_ASIO_REUSE_OBJECT
+		return invalid_object_can.size() + reusable_object_can.size();
+#else
 		return invalid_object_can.size();
+#endif
 	}
 
 	object_type find(uint_fast64_t id)
@@ -228,29 +326,55 @@ public:
 	object_type invalid_object_at(size_t index)
 	{
 		boost::shared_lock<boost::shared_mutex> lock(invalid_object_can_mutex);
-		assert(index < invalid_object_can.size());
-		return index < invalid_object_can.size() ? *std::next(std::begin(invalid_object_can), index) : object_type();
+		if (index < invalid_object_can.size())
+			return *std::next(std::begin(invalid_object_can), index);
+#ifdef ST_ASIO_REUSE_OBJECT
+		index -= invalid_object_can.size();
+		if (index < reusable_object_can.size())
+			return *std::next(std::begin(reusable_object_can), index);
+#endif
+
+		assert(false);
+		return object_type();
 	}
 
-	//this method has linear complexity, please note.
+	//objects in reusable_object_can will be searched linearly, please note.
 	object_type invalid_object_find(uint_fast64_t id)
 	{
 		boost::shared_lock<boost::shared_mutex> lock(invalid_object_can_mutex);
-		auto iter = std::find_if(std::begin(invalid_object_can), std::end(invalid_object_can), [id](object_ctype& item) {return item->is_equal_to(id);});
-		return iter == std::end(invalid_object_can) ? object_type() : *iter;
+		auto iter = invalid_object_can.find(id, st_object_hasher(), st_object_equal());
+		if (iter != std::end(invalid_object_can))
+			return *iter;
+#ifdef ST_ASIO_REUSE_OBJECT
+		auto reusable_iter = std::find_if(std::begin(reusable_object_can), std::end(reusable_object_can), [id](object_ctype& item) {return item->is_equal_to(id);});
+		if (reusable_iter != std::end(reusable_object_can))
+			return *reusable_iter;
+#endif
+
+		return object_type();
 	}
 
-	//this method has linear complexity, please note.
+	//objects in reusable_object_can will be searched linearly, please note.
 	object_type invalid_object_pop(uint_fast64_t id)
 	{
-		boost::shared_lock<boost::shared_mutex> lock(invalid_object_can_mutex);
-		auto iter = std::find_if(std::begin(invalid_object_can), std::end(invalid_object_can), [id](object_ctype& item) {return item->is_equal_to(id);});
+		boost::unique_lock<boost::shared_mutex> lock(invalid_object_can_mutex);
+		auto iter = invalid_object_can.find(id, st_object_hasher(), st_object_equal());
 		if (iter != std::end(invalid_object_can))
 		{
-			auto object_ptr(std::move(*iter));
+			auto object_ptr(*iter);
 			invalid_object_can.erase(iter);
 			return object_ptr;
 		}
+#ifdef ST_ASIO_REUSE_OBJECT
+		auto reusable_iter = std::find_if(std::begin(reusable_object_can), std::end(reusable_object_can), [id](object_ctype& item) {return item->is_equal_to(id);});
+		if (reusable_iter != std::end(reusable_object_can))
+		{
+			auto object_ptr(std::move(*reusable_iter));
+			reusable_object_can.erase(reusable_iter);
+			return object_ptr;
+		}
+#endif
+
 		return object_type();
 	}
 
@@ -263,7 +387,7 @@ public:
 	//st_object_pool will automatically invoke this function if ST_ASIO_CLEAR_OBJECT_INTERVAL been defined
 	size_t clear_obsoleted_object()
 	{
-		decltype(invalid_object_can) objects;
+		boost::container::list<object_type> objects;
 
 		boost::unique_lock<boost::shared_mutex> lock(object_can_mutex);
 		for (auto iter = std::begin(object_can); iter != std::end(object_can);)
@@ -274,6 +398,8 @@ public:
 			}
 			else
 				++iter;
+		for (auto iter = std::begin(objects); iter != std::end(objects); ++iter)
+			leave_all_group(*iter); //under object_can_mutex, see del_object
 		lock.unlock();
 
 		auto size = objects.size();
@@ -282,7 +408,7 @@ public:
 			unified_out::warning_out(ST_ASIO_SF " object(s) been kicked out!", size);
 
 			boost::unique_lock<boost::shared_mutex> lock(invalid_object_can_mutex);
-			invalid_object_can.splice(std::end(invalid_object_can), objects);
+			invalid_object_can.insert(std::begin(objects), std::end(objects));
 		}
 
 		return size;
@@ -298,6 +424,10 @@ public:
 		size_t num_affected = 0;
 
 		boost::unique_lock<boost::shared_mutex> lock(invalid_object_can_mutex);
+#ifdef ST_ASIO_REUSE_OBJECT
+		for (; num > 0 && !reusable_object_can.empty(); --num, ++num_affected)
+			reusable_object_can.pop_front();
+#endif
 		for (auto iter = std::begin(invalid_object_can); num > 0 && iter != std::end(invalid_object_can);)
 			if ((*iter)->obsoleted())
 			{
@@ -318,6 +448,124 @@ public:
 	DO_SOMETHING_TO_ALL_MUTEX(object_can, object_can_mutex)
 	DO_SOMETHING_TO_ONE_MUTEX(object_can, object_can_mutex)
 
+	//groups (topics), an object can join any number of groups, and will leave all of them automatically when it's deleted from the pool
+	//(del_object or clear_obsoleted_object), members are held by group_can directly, so traversing a group doesn't need to find members one by one.
+	//return false if object_ptr already in (join_group) or not in (leave_group) the group, or not in the pool (join_group).
+	//join_group locks object_can_mutex (shared) before group_can_mutex, the same order as del_object, so it's not allowed to call it in
+	//do_something_to_all or do_something_to_one (shared_mutex is not recursive).
+	bool join_group(const std::string& group, object_ctype& object_ptr)
+	{
+		assert(object_ptr);
+
+		boost::shared_lock<boost::shared_mutex> lock(object_can_mutex);
+		auto iter = object_can.find(object_ptr);
+		return iter != std::end(object_can) && *iter == object_ptr ? do_join_group(group, object_ptr) : false;
+	}
+
+	bool leave_group(const std::string& group, object_ctype& object_ptr)
+	{
+		assert(object_ptr);
+
+		boost::unique_lock<boost::shared_mutex> lock(group_can_mutex);
+		auto iter = group_can.find(group);
+		if (iter == std::end(group_can) || 0 == iter->second.erase(object_ptr))
+			return false;
+		else if (iter->second.empty())
+			group_can.erase(iter);
+
+		auto object_iter = object_group_can.find(object_ptr->id());
+		assert(object_iter != std::end(object_group_can));
+		object_iter->second.remove(group);
+		if (object_iter->second.empty())
+			object_group_can.erase(object_iter);
+
+		return true;
+	}
+
+	void leave_all_group(object_ctype& object_ptr)
+	{
+		assert(object_ptr);
+
+		boost::unique_lock<boost::shared_mutex> lock(group_can_mutex);
+		auto object_iter = object_group_can.find(object_ptr->id());
+		if (object_iter == std::end(object_group_can))
+			return;
+
+		for (auto group_iter = std::begin(object_iter->second); group_iter != std::end(object_iter->second); ++group_iter)
+		{
+			auto iter = group_can.find(*group_iter);
+			if (iter != std::end(group_can) && iter->second.erase(object_ptr) > 0 && iter->second.empty())
+				group_can.erase(iter);
+		}
+		object_group_can.erase(object_iter);
+	}
+
+	size_t group_size(const std::string& group)
+	{
+		boost::shared_lock<boost::shared_mutex> lock(group_can_mutex);
+		auto iter = group_can.find(group);
+		return iter == std::end(group_can) ? 0 : iter->second.size();
+	}
+
+	template<typename _Predicate> void do_something_to_group(const std::string& group, const _Predicate& __pred)
+	{
+		boost::shared_lock<boost::shared_mutex> lock(group_can_mutex);
+		auto iter = group_can.find(group);
+		if (iter != std::end(group_can))
+			for (auto& item : iter->second)
+				__pred(item);
+	}
+
+	//traverse a snapshot of all objects in service threads, object_can_mutex is only locked while taking the snapshot (copying pointers), so
+	//add_object and del_object will not be blocked during the traversal, the snapshot is split into parts (see ST_ASIO_ASYNC_TRAVERSE_PART_SIZE),
+	//each part is posted to an io_service (round-robin if st_multi_service_pump is used), so parts will be traversed in different threads concurrently.
+	//__pred must be thread safe, __done (if not empty) will be invoked in a service thread after all objects been traversed.
+	template<typename _Predicate> void do_something_to_all_async(const _Predicate& __pred, const std::function<void()>& __done = std::function<void()>())
+	{
+		auto objects = boost::make_shared<std::vector<object_type>>();
+		boost::shared_lock<boost::shared_mutex> lock(object_can_mutex);
+		objects->assign(std::begin(object_can), std::end(object_can));
+		lock.unlock();
+
+		post_traverse(objects, __pred, __done);
+	}
+
+protected:
+	//the container which holds object_ptr must be locked by the caller, see join_group.
+	bool do_join_group(const std::string& group, object_ctype& object_ptr)
+	{
+		boost::unique_lock<boost::shared_mutex> lock(group_can_mutex);
+		if (!group_can[group].insert(object_ptr).second)
+			return false;
+
+		object_group_can[object_ptr->id()].push_back(group);
+		return true;
+	}
+
+	template<typename _Predicate> void post_traverse(const boost::shared_ptr<std::vector<object_type>>& objects, const _Predicate& __pred, const std::function<void()>& __done)
+	{
+		auto size = objects->size();
+		if (0 == size)
+		{
+			if (__done)
+				__done();
+			return;
+		}
+
+		auto part_num = (size + ST_ASIO_ASYNC_TRAVERSE_PART_SIZE - 1) / ST_ASIO_ASYNC_TRAVERSE_PART_SIZE;
+		auto left_part_num = boost::make_shared<st_atomic_size_t>(part_num);
+		for (size_t i = 0; i < part_num; ++i)
+		{
+			auto begin = i * ST_ASIO_ASYNC_TRAVERSE_PART_SIZE, end = std::min(begin + ST_ASIO_ASYNC_TRAVERSE_PART_SIZE, size);
+			sp.get_io_service(i % sp.io_service_num()).post([=]() {
+				for (auto j = begin; j < end; ++j)
+					__pred((*objects)[j]);
+				if (0 == --*left_part_num && __done)
+					__done();
+			});
+		}
+	}
+
 protected:
 	st_atomic_uint_fast64 cur_id;
 
@@ -330,8 +578,214 @@ protected:
 	//and will be dequeued in the future, we must guarantee these objects not be freed from the heap or reused, so we move these objects from object_can to invalid_object_can,
 	//and free them from the heap or reuse them in the near future.
 	//if ST_ASIO_CLEAR_OBJECT_INTERVAL been defined, clear_obsoleted_object() will be invoked automatically and periodically to move all invalid objects into invalid_object_can.
-	boost::container::list<object_type> invalid_object_can;
+	//invalid_object_can is indexed by id, so invalid_object_find and invalid_object_pop are O(1).
+	container_type invalid_object_can;
+#ifdef ST_ASIO_REUSE_OBJECT
+	//objects which are ready for reusing (collected from invalid_object_can by collect_reusable_object()), also protected by invalid_object_can_mutex.
+	boost::container::list<object_type> reusable_object_can;
+	size_t collect_bucket; //where the next collection starts, see do_collect_reusable_object()
+#endif
 	boost::shared_mutex invalid_object_can_mutex;
+
+	//members of each group, and groups of each object (indexed by id, for leaving all groups quickly), protected by group_can_mutex.
+	boost::unordered::unordered_map<std::string, container_type> group_can;
+	boost::unordered::unordered_map<uint_fast64_t, boost::container::list<std::string>> object_group_can;
+	boost::shared_mutex group_can_mutex;
+};
+
+//objects are distributed into ShardNum shards by their ids, each shard has its own unordered_set and shared_mutex, so adding, deleting and finding objects
+//in different shards will not block each other, this is useful when there're lots of connections been established and closed concurrently (short-term connection).
+//can be used as the Pool template parameter of st_server_base, for example: st_server_base<st_server_socket, st_sharded_object_pool<st_server_socket>>
+//please note that do_something_to_all and do_something_to_one lock shards one by one, so they don't traverse a snapshot of all objects as st_object_pool does,
+//objects added or deleted in other threads during the traversal may or may not be visited.
+template<typename Object, size_t ShardNum = ST_ASIO_OBJECT_POOL_SHARD_NUM>
+class st_sharded_object_pool : public st_object_pool<Object>
+{
+protected:
+	typedef st_object_pool<Object> super;
+
+public:
+	typedef typename super::object_type object_type;
+	typedef typename super::object_ctype object_ctype;
+	typedef typename super::container_type container_type;
+
+protected:
+	struct shard
+	{
+		container_type object_can;
+		boost::shared_mutex object_can_mutex;
+	};
+
+	st_sharded_object_pool(st_service_pump& service_pump_) : super(service_pump_), total_size(0) {}
+
+	void start()
+	{
+#ifndef ST_ASIO_REUSE_OBJECT
+		ST_THIS set_timer(super::TIMER_FREE_SOCKET, 1000 * ST_ASIO_FREE_OBJECT_INTERVAL, [this](typename super::tid id)->bool {ST_THIS free_object(); return true;});
+#else
+		ST_THIS set_timer(super::TIMER_COLLECT_SOCKET, 1000 * ST_ASIO_COLLECT_OBJECT_INTERVAL, [this](typename super::tid id)->bool {ST_THIS collect_reusable_object(); return true;});
+#endif
+#ifdef ST_ASIO_CLEAR_OBJECT_INTERVAL
+		ST_THIS set_timer(super::TIMER_CLEAR_SOCKET, 1000 * ST_ASIO_CLEAR_OBJECT_INTERVAL, [this](typename super::tid id)->bool {ST_THIS clear_obsoleted_object(); return true;});
+#endif
+	}
+
+	bool add_object(object_ctype& object_ptr)
+	{
+		assert(object_ptr && !object_ptr->is_equal_to(-1));
+
+		if (++total_size > ST_THIS max_size_)
+		{
+			--total_size;
+			return false;
+		}
+
+		auto& s = get_shard(object_ptr->id());
+		boost::unique_lock<boost::shared_mutex> lock(s.object_can_mutex);
+		if (s.object_can.insert(object_ptr).second)
+			return true;
+		lock.unlock();
+
+		--total_size;
+		return false;
+	}
+
+	bool del_object(object_ctype& object_ptr)
+	{
+		assert(object_ptr);
+
+		auto& s = get_shard(object_ptr->id());
+		boost::unique_lock<boost::shared_mutex> lock(s.object_can_mutex);
+		auto exist = s.object_can.erase(object_ptr) > 0;
+		if (exist)
+			ST_THIS leave_all_group(object_ptr); //under the shard's lock, see st_object_pool::del_object
+		lock.unlock();
+
+		if (exist)
+		{
+			--total_size;
+
+			boost::unique_lock<boost::shared_mutex> lock(ST_THIS invalid_object_can_mutex);
+			ST_THIS invalid_object_can.insert(object_ptr);
+		}
+
+		return exist;
+	}
+
+	shard& get_shard(uint_fast64_t id) {return shards[(size_t) (id % ShardNum)];}
+
+public:
+	//to configure unordered_set of each shard, not thread safe, so must be called before service_pump startup.
+	container_type& container(size_t shard_index) {assert(shard_index < ShardNum); return shards[shard_index].object_can;}
+	static size_t shard_num() {return ShardNum;}
+
+	size_t size() const {return total_size;}
+
+	object_type find(uint_fast64_t id)
+	{
+		auto& s = get_shard(id);
+		boost::shared_lock<boost::shared_mutex> lock(s.object_can_mutex);
+		auto iter = s.object_can.find(id, typename super::st_object_hasher(), typename super::st_object_equal());
+		return iter != std::end(s.object_can) ? *iter : object_type();
+	}
+
+	//this method has linear complexity, please note.
+	object_type at(size_t index)
+	{
+		for (auto iter = std::begin(shards); iter != std::end(shards); ++iter)
+		{
+			boost::shared_lock<boost::shared_mutex> lock(iter->object_can_mutex);
+			if (index < iter->object_can.size())
+				return *std::next(std::begin(iter->object_can), index);
+
+			index -= iter->object_can.size();
+		}
+
+		return object_type();
+	}
+
+	void list_all_object() {do_something_to_all([](object_ctype& item) {item->show_info("", "");});}
+
+	//see st_object_pool::join_group, the shard which object_ptr belongs to is locked instead of object_can_mutex.
+	bool join_group(const std::string& group, object_ctype& object_ptr)
+	{
+		assert(object_ptr);
+
+		auto& s = get_shard(object_ptr->id());
+		boost::shared_lock<boost::shared_mutex> lock(s.object_can_mutex);
+		auto iter = s.object_can.find(object_ptr);
+		return iter != std::end(s.object_can) && *iter == object_ptr ? ST_THIS do_join_group(group, object_ptr) : false;
+	}
+
+	size_t clear_obsoleted_object()
+	{
+		boost::container::list<object_type> objects;
+
+		for (auto iter = std::begin(shards); iter != std::end(shards); ++iter)
+		{
+			boost::unique_lock<boost::shared_mutex> lock(iter->object_can_mutex);
+			for (auto object_iter = std::begin(iter->object_can); object_iter != std::end(iter->object_can);)
+				if ((*object_iter)->obsoleted())
+				{
+					ST_THIS leave_all_group(*object_iter); //under the shard's lock, see st_object_pool::del_object
+					objects.push_back(std::move(*object_iter));
+					object_iter = iter->object_can.erase(object_iter);
+				}
+				else
+					++object_iter;
+		}
+
+		auto size = objects.size();
+		if (0 != size)
+		{
+			total_size -= size;
+			unified_out::warning_out(ST_ASIO_SF " object(s) been kicked out!", size);
+
+			boost::unique_lock<boost::shared_mutex> lock(ST_THIS invalid_object_can_mutex);
+			ST_THIS invalid_object_can.insert(std::begin(objects), std::end(objects));
+		}
+
+		return size;
+	}
+
+	template<typename _Predicate> void do_something_to_all(const _Predicate& __pred)
+	{
+		for (auto iter = std::begin(shards); iter != std::end(shards); ++iter)
+		{
+			boost::shared_lock<boost::shared_mutex> lock(iter->object_can_mutex);
+			for (auto& item : iter->object_can)
+				__pred(item);
+		}
+	}
+
+	template<typename _Predicate> void do_something_to_one(const _Predicate& __pred)
+	{
+		for (auto iter = std::begin(shards); iter != std::end(shards); ++iter)
+		{
+			boost::shared_lock<boost::shared_mutex> lock(iter->object_can_mutex);
+			for (auto object_iter = std::begin(iter->object_can); object_iter != std::end(iter->object_can); ++object_iter)
+				if (__pred(*object_iter))
+					return;
+		}
+	}
+
+	//see st_object_pool::do_something_to_all_async, shards are locked one by one while taking the snapshot.
+	template<typename _Predicate> void do_something_to_all_async(const _Predicate& __pred, const std::function<void()>& __done = std::function<void()>())
+	{
+		auto objects = boost::make_shared<std::vector<object_type>>();
+		objects->reserve(total_size);
+		for (auto iter = std::begin(shards); iter != std::end(shards); ++iter)
+		{
+			boost::shared_lock<boost::shared_mutex> lock(iter->object_can_mutex);
+			objects->insert(std::end(*objects), std::begin(iter->object_can), std::end(iter->object_can));
+		}
+
+		ST_THIS post_traverse(objects, __pred, __done);
+	}
+
+protected:
+	boost::array<shard, ShardNum> shards;
+	st_atomic_size_t total_size;
 };
 
 } //namespace
@@ -25,6 +25,32 @@ static_assert(ST_ASIO_SERVER_PORT > 0, "server port must be bigger than zero.");
 #endif
 static_assert(ST_ASIO_ASYNC_ACCEPT_NUM > 0, "async accept number must be bigger than zero.");
 
+//how many acceptors listen on the server address, if bigger than 1, all acceptors will be bound to the same address with SO_REUSEPORT,
+//so the kernel will balance new connections among them, and acceptors will be distributed to io_services of the service pump (see st_multi_service_pump),
+//each acceptor has ST_ASIO_ASYNC_ACCEPT_NUM async_accept delivered concurrently.
+#ifndef ST_ASIO_ACCEPTOR_NUM
+#define ST_ASIO_ACCEPTOR_NUM		1
+#elif ST_ASIO_ACCEPTOR_NUM <= 0
+	#error acceptor number must be bigger than zero.
+#elif ST_ASIO_ACCEPTOR_NUM > 1 && !defined(SO_REUSEPORT)
+	#error SO_REUSEPORT is not supported on this platform, ST_ASIO_ACCEPTOR_NUM must be 1.
+#endif
+
+//after an async_accept completed successfully, how many more connections (at most) can be accepted synchronously (non-blocking accept until EAGAIN)
+//before delivering the next async_accept, this saves one reactor round trip per connection when connections arrive in bursts,
+//and the limitation keeps other acceptors and io_service handlers from starvation. 1 (the default) means no synchronous accepting, 16 is a good start.
+#ifndef ST_ASIO_ACCEPT_BURST_NUM
+#define ST_ASIO_ACCEPT_BURST_NUM	1
+#endif
+static_assert(ST_ASIO_ACCEPT_BURST_NUM > 0, "accept burst number must be bigger than zero.");
+
+//how many socket objects will be created ahead of time (when starting service and after each accepting), so accepting needn't create objects on the fly,
+//0 means create objects only when needed.
+#ifndef ST_ASIO_WARM_OBJECT_NUM
+#define ST_ASIO_WARM_OBJECT_NUM		0
+#endif
+static_assert(ST_ASIO_WARM_OBJECT_NUM >= 0, "warm object number must be equal to or bigger than zero.");
+
 //in set_server_addr, if the IP is empty, ST_ASIO_TCP_DEFAULT_IP_VERSION will define the IP version, or the IP version will be deduced by the IP address.
 //boost::asio::ip::tcp::v4() means ipv4 and boost::asio::ip::tcp::v6() means ipv6.
 #ifndef ST_ASIO_TCP_DEFAULT_IP_VERSION
@@ -63,8 +89,25 @@ public:
 	}
 	const boost::asio::ip::tcp::endpoint& get_server_addr() const {return server_addr;}
 
-	void stop_listen() {boost::system::error_code ec; acceptor.cancel(ec); acceptor.close(ec);}
-	bool is_listening() const {return acceptor.is_open();}
+	void stop_listen()
+	{
+		boost::system::error_code ec;
+		acceptor.cancel(ec); acceptor.close(ec);
+		for (auto iter = std::begin(extra_acceptors); iter != std::end(extra_acceptors); ++iter)
+			{(*iter)->cancel(ec); (*iter)->close(ec);}
+	}
+	//true if any acceptor is still listening
+	bool is_listening() const
+	{
+		if (acceptor.is_open())
+			return true;
+
+		for (auto iter = std::begin(extra_acceptors); iter != std::end(extra_acceptors); ++iter)
+			if ((*iter)->is_open())
+				return true;
+
+		return false;
+	}
 
 	//implement i_server's pure virtual functions
 	virtual st_service_pump& get_service_pump() {return Pool::get_service_pump();}
@@ -86,6 +129,18 @@ public:
 	//guarantee send msg successfully even if can_overflow equal to false, success at here just means putting the msg into send buffer successfully
 	TCP_BROADCAST_MSG(safe_broadcast_msg, safe_send_msg)
 	TCP_BROADCAST_MSG(safe_broadcast_native_msg, safe_send_native_msg)
+	//pack only once (outside the pool's lock) and share the packed msg among all st_sockets without copying its content
+	TCP_SHARED_BROADCAST_MSG(shared_broadcast_msg, false)
+	TCP_SHARED_BROADCAST_MSG(shared_broadcast_native_msg, true)
+	TCP_DIRECT_BROADCAST_MSG(direct_broadcast_msg)
+	//like shared_broadcast_msg, but put the packed msg into send buffers in service threads concurrently and returns immediately
+	TCP_PARALLEL_BROADCAST_MSG(parallel_broadcast_msg, false)
+	TCP_PARALLEL_BROADCAST_MSG(parallel_broadcast_native_msg, true)
+	TCP_PARALLEL_DIRECT_BROADCAST_MSG(parallel_direct_broadcast_msg)
+	//pack only once and send the msg to all st_sockets in a group (see st_object_pool::join_group)
+	TCP_GROUP_SEND_MSG(group_send_msg, false)
+	TCP_GROUP_SEND_MSG(group_send_native_msg, true)
+	TCP_DIRECT_GROUP_SEND_MSG(direct_group_send_msg)
 	//msg sending interface
 	///////////////////////////////////////////////////
 
@@ -96,20 +151,33 @@ public:
 protected:
 	virtual bool init()
 	{
-		boost::system::error_code ec;
-		acceptor.open(server_addr.protocol(), ec); assert(!ec);
-#ifndef ST_ASIO_NOT_REUSE_ADDRESS
-		acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true), ec); assert(!ec);
-#endif
-		acceptor.bind(server_addr, ec); assert(!ec);
-		if (ec) {get_service_pump().stop(); unified_out::error_out("bind failed."); return false;}
-		acceptor.listen(boost::asio::ip::tcp::acceptor::max_connections, ec); assert(!ec);
-		if (ec) {get_service_pump().stop(); unified_out::error_out("listen failed."); return false;}
+		if (!listen(acceptor))
+			return false;
+
+		extra_acceptors.clear(); //this is needed when restart service
+		for (auto i = 1; i < ST_ASIO_ACCEPTOR_NUM; ++i)
+		{
+			auto& service_pump_ = get_service_pump();
+			extra_acceptors.push_back(boost::make_shared<boost::asio::ip::tcp::acceptor>(service_pump_.get_io_service(i % service_pump_.io_service_num())));
+			if (!listen(*extra_acceptors.back()))
+			{
+				stop_listen();
+				return false;
+			}
+		}
 
 		ST_THIS start();
+#if ST_ASIO_WARM_OBJECT_NUM > 0
+		filling_warm_objects = 0;
+#endif
+		fill_warm_objects();
 
 		for (auto i = 0; i < ST_ASIO_ASYNC_ACCEPT_NUM; ++i)
-			start_next_accept();
+		{
+			start_next_accept(acceptor);
+			for (auto iter = std::begin(extra_acceptors); iter != std::end(extra_acceptors); ++iter)
+				start_next_accept(**iter);
+		}
 
 		return true;
 	}
@@ -118,7 +186,8 @@ protected:
 
 	//if you want to ignore this error and continue to accept new connections immediately, return true in this virtual function;
 	//if you want to ignore this error and continue to accept new connections after a specific delay, start a timer immediately and return false (don't call stop_listen()),
-	// when the timer ends up, call start_next_accept() in the callback function.
+	// when the timer ends up, call start_next_accept() in the callback function (if ST_ASIO_ACCEPTOR_NUM is bigger than 1, you must remember which acceptor
+	// the error occurred on (rewrite start_next_accept(acceptor) to do it), and call start_next_accept(acceptor) with it).
 	//otherwise, don't rewrite this virtual function or call st_server_base::on_accept_error() directly after your code.
 	virtual bool on_accept_error(const boost::system::error_code& ec, typename Pool::object_ctype& client_ptr)
 	{
@@ -131,10 +200,36 @@ protected:
 		return false;
 	}
 
-	virtual void start_next_accept()
+	//deliver an async_accept on the primary acceptor (the only acceptor if ST_ASIO_ACCEPTOR_NUM equal to 1).
+	virtual void start_next_accept() {do_start_next_accept(acceptor);}
+	//the primary acceptor will be routed to start_next_accept() above, so rewriting either of them works for the primary acceptor.
+	virtual void start_next_accept(boost::asio::ip::tcp::acceptor& acceptor_) {if (&acceptor == &acceptor_) start_next_accept(); else do_start_next_accept(acceptor_);}
+
+	void do_start_next_accept(boost::asio::ip::tcp::acceptor& acceptor_)
 	{
-		auto client_ptr = ST_THIS create_object(*this);
-		acceptor.async_accept(client_ptr->lowest_layer(), [=](const boost::system::error_code& ec) {ST_THIS accept_handler(ec, client_ptr);});
+		auto client_ptr = create_client();
+		acceptor_.async_accept(client_ptr->lowest_layer(), [=, &acceptor_](const boost::system::error_code& ec) {ST_THIS accept_handler(ec, client_ptr, acceptor_);});
+	}
+
+	bool listen(boost::asio::ip::tcp::acceptor& acceptor_)
+	{
+		boost::system::error_code ec;
+		acceptor_.open(server_addr.protocol(), ec); assert(!ec);
+#ifndef ST_ASIO_NOT_REUSE_ADDRESS
+		acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true), ec); assert(!ec);
+#endif
+#if ST_ASIO_ACCEPTOR_NUM > 1
+		acceptor_.set_option(boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true), ec); assert(!ec);
+#endif
+		acceptor_.bind(server_addr, ec); assert(!ec);
+		if (ec) {get_service_pump().stop(); unified_out::error_out("bind failed."); return false;}
+		acceptor_.listen(boost::asio::ip::tcp::acceptor::max_connections, ec); assert(!ec);
+		if (ec) {get_service_pump().stop(); unified_out::error_out("listen failed."); return false;}
+#if ST_ASIO_ACCEPT_BURST_NUM > 1
+		acceptor_.non_blocking(true, ec); assert(!ec); //for synchronous accepting in accept_burst, async_accept is not affected
+#endif
+
+		return true;
 	}
 
 protected:
@@ -151,22 +246,111 @@ protected:
 		return false;
 	}
 
-	void accept_handler(const boost::system::error_code& ec, typename Pool::object_ctype& client_ptr)
+	//take an object from the warm objects (include spare objects returned by return_client), or create a new one if no objects available.
+	typename Pool::object_type create_client()
 	{
-		if (!ec)
+		boost::unique_lock<boost::mutex> lock(warm_object_can_mutex);
+		if (!warm_object_can.empty())
+		{
+			auto client_ptr(warm_object_can.front());
+			warm_object_can.pop_front();
+			return client_ptr;
+		}
+		lock.unlock();
+
+		return ST_THIS create_object(*this);
+	}
+
+	void fill_warm_objects()
+	{
+#if ST_ASIO_WARM_OBJECT_NUM > 0
+		boost::unique_lock<boost::mutex> lock(warm_object_can_mutex);
+		auto num = warm_object_can.size() < ST_ASIO_WARM_OBJECT_NUM ? ST_ASIO_WARM_OBJECT_NUM - warm_object_can.size() : 0;
+		lock.unlock();
+
+		//create objects without locking, other threads may fill too, that's okay (at most a few more objects than ST_ASIO_WARM_OBJECT_NUM)
+		boost::container::list<typename Pool::object_type> objects;
+		for (size_t i = 0; i < num; ++i)
+			objects.push_back(ST_THIS create_object(*this));
+
+		lock.lock();
+		warm_object_can.splice(std::end(warm_object_can), objects);
+#endif
+	}
+
+	//fill warm objects in a separate handler, so accept_handler can return to the io_service as soon as possible,
+	//at most one such handler will be queued at any time.
+	void post_fill_warm_objects()
+	{
+#if ST_ASIO_WARM_OBJECT_NUM > 0
+		if (0 == filling_warm_objects.exchange(1))
+			get_service_pump().post([this]() {ST_THIS fill_warm_objects(); ST_THIS filling_warm_objects = 0;});
+#endif
+	}
+
+	//return a not used object (created by create_client) as a spare object, it will be taken by the next create_client,
+	//so probing in accept_burst costs nothing even if no warm objects been configured.
+	void return_client(typename Pool::object_ctype& client_ptr)
+	{
+		boost::unique_lock<boost::mutex> lock(warm_object_can_mutex);
+		warm_object_can.push_back(client_ptr);
+	}
+
+	//a connection has been accepted, st_ssl_server_base will do handshake before adding the client.
+	virtual void handle_accepted(typename Pool::object_ctype& client_ptr)
+	{
+		if (on_accept(client_ptr) && add_client(client_ptr))
+			client_ptr->start();
+	}
+
+	//accept connections which already queued in the acceptor synchronously, until EAGAIN or ST_ASIO_ACCEPT_BURST_NUM - 1 connections been accepted.
+	//errors other than EAGAIN are not handled here, the next async_accept will get them again and pass them to on_accept_error.
+	void accept_burst(boost::asio::ip::tcp::acceptor& acceptor_)
+	{
+		for (auto i = 1; i < ST_ASIO_ACCEPT_BURST_NUM && acceptor_.is_open(); ++i)
 		{
-			if (on_accept(client_ptr) && add_client(client_ptr))
-				client_ptr->start();
+			auto client_ptr = create_client();
+			boost::system::error_code ec;
+			acceptor_.accept(client_ptr->lowest_layer(), ec);
+			if (ec)
+			{
+				return_client(client_ptr);
+				break;
+			}
 
-			start_next_accept();
+			handle_accepted(client_ptr);
+		}
+	}
+
+	void accept_handler(const boost::system::error_code& ec, typename Pool::object_ctype& client_ptr, boost::asio::ip::tcp::acceptor& acceptor_)
+	{
+		if (!ec)
+		{
+			handle_accepted(client_ptr);
+			accept_burst(acceptor_);
+			start_next_accept(acceptor_);
+			post_fill_warm_objects();
+		}
+		else
+		{
+			auto restart = on_accept_error(ec, client_ptr);
+			return_client(client_ptr);
+			if (restart)
+				start_next_accept(acceptor_);
 		}
-		else if (on_accept_error(ec, client_ptr))
-			start_next_accept();
 	}
 
 protected:
 	boost::asio::ip::tcp::endpoint server_addr;
 	boost::asio::ip::tcp::acceptor acceptor;
+	boost::container::list<boost::shared_ptr<boost::asio::ip::tcp::acceptor>> extra_acceptors; //only used when ST_ASIO_ACCEPTOR_NUM is bigger than 1
+
+	//warm objects (see ST_ASIO_WARM_OBJECT_NUM macro) and spare objects (see return_client)
+	boost::container::list<typename Pool::object_type> warm_object_can;
+	boost::mutex warm_object_can_mutex;
+#if ST_ASIO_WARM_OBJECT_NUM > 0
+	st_atomic_size_t filling_warm_objects;
+#endif
 };
 
 } //namespace
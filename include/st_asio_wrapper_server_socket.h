@@ -33,9 +33,11 @@ public:
 	static const st_timer::tid TIMER_ASYNC_SHUTDOWN = TIMER_BEGIN;
 	static const st_timer::tid TIMER_END = TIMER_BEGIN + 10;
 
-	st_server_socket_base(Server& server_) : super(server_.get_service_pump()), server(server_) {}
+	st_server_socket_base(Server& server_) : super(server_.get_service_pump().assign_io_service()), server(server_), service_pump(server_.get_service_pump()) {}
 	template<typename Arg>
-	st_server_socket_base(Server& server_, Arg& arg) : super(server_.get_service_pump(), arg), server(server_) {}
+	st_server_socket_base(Server& server_, Arg& arg) : super(server_.get_service_pump().assign_io_service(), arg), server(server_), service_pump(server_.get_service_pump()) {}
+	//do not call server.get_service_pump() here, the server may have been destructed (st_object_pool frees its objects in its destructor)
+	~st_server_socket_base() {service_pump.release_io_service(ST_THIS get_io_service());}
 
 	//reset all, be ensure that there's no any operations performed on this socket when invoke it
 	//please note, when reuse this socket, st_object_pool will invoke reset(), child must re-write it to initialize all member variables,
@@ -131,6 +133,7 @@ private:
 
 protected:
 	Server& server;
+	st_service_pump& service_pump; //the one which assigned our io_service
 };
 
 } //namespace
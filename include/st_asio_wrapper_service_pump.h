@@ -152,14 +152,23 @@ public:
 	//stop the service, must be invoked explicitly when the service need to stop, for example, close the application
 	//only for service pump started by 'run_service', this function will return immediately,
 	//only the return from 'run_service' means service pump ended.
-	void end_service() {if (is_service_started()) do_something_to_all([](object_type& item) {item->stop_service();});}
+	virtual void end_service() {if (is_service_started()) do_something_to_all([](object_type& item) {item->stop_service();});}
+
+	//which io_service a new object (for example, an accepted socket) should use, st_multi_service_pump distributes objects to its io_services,
+	//call release_io_service when the object is being destroyed.
+	virtual boost::asio::io_service& assign_io_service() {return *this;}
+	virtual void release_io_service(boost::asio::io_service& io_service_) {}
+
+	//st_multi_service_pump has more than one io_service
+	virtual size_t io_service_num() const {return 1;}
+	virtual boost::asio::io_service& get_io_service(size_t index) {assert(0 == index); return *this;}
 
 	bool is_running() const {return !stopped();}
 	bool is_service_started() const {return started;}
 	void add_service_thread(int thread_num) {for (auto i = 0; i < thread_num; ++i) service_threads.create_thread([this]() {boost::system::error_code ec; ST_THIS run(ec);});}
 
 protected:
-	void do_service(int thread_num)
+	virtual void do_service(int thread_num)
 	{
 		started = true;
 		unified_out::info_out("service pump started.");
@@ -215,6 +224,136 @@ protected:
 	bool started;
 };
 
+//one io_service per thread, objects (accepted sockets) are distributed to these io_services (round-robin or least-load, see assign_io_service),
+//so all handlers of an object will always be invoked in the same thread, and io_services will not contend with each other.
+//the first io_service is the st_service_pump itself, it runs acceptors and timers of services (and objects assigned to it),
+//it can be run by more than one thread (thread_num parameter of start_service and run_service, which only means the thread number of the first io_service
+//here, and the total thread number is thread_num + io_service_num() - 1), others are always run by one thread each.
+//please note:
+// 1. object number of each io_service (the load) is counted from assign_io_service() to release_io_service(), so objects waiting for reusing
+//    or freeing (in st_object_pool::invalid_object_can) are counted too;
+// 2. io_services are created in the constructor and never changed, so objects can safely hold references to them.
+class st_multi_service_pump : public st_service_pump
+{
+public:
+	enum distribution_policy {ROUND_ROBIN, LEAST_LOAD};
+
+	//if pin_thread is true, the thread of the n(th) io_service (start from 1) will be bound to the (n % cpu number)th cpu.
+	st_multi_service_pump(size_t io_service_num = ST_ASIO_SERVICE_THREAD_NUM, distribution_policy policy_ = ROUND_ROBIN, bool pin_thread_ = false) :
+		policy(policy_), pin_thread(pin_thread_), next_io_service(0), loads(new st_atomic_size_t[io_service_num])
+	{
+		assert(io_service_num > 0);
+
+		io_services.push_back(this);
+		for (size_t i = 1; i < io_service_num; ++i)
+		{
+			extra_io_services.push_back(boost::make_shared<boost::asio::io_service>());
+			io_services.push_back(extra_io_services.back().get());
+		}
+
+		for (size_t i = 0; i < io_service_num; ++i)
+			loads[i] = 0;
+	}
+
+	virtual size_t io_service_num() const {return io_services.size();}
+	virtual boost::asio::io_service& get_io_service(size_t index) {assert(index < io_services.size()); return *io_services[index];}
+	size_t load(size_t index) const {assert(index < io_services.size()); return loads[index];}
+
+	distribution_policy distribution() const {return policy;}
+	void distribution(distribution_policy policy_) {policy = policy_;}
+
+	virtual void end_service()
+	{
+		st_service_pump::end_service();
+		works.clear(); //let extra io_services quit after all handlers been invoked
+	}
+
+	virtual boost::asio::io_service& assign_io_service()
+	{
+		size_t index = 0;
+		if (LEAST_LOAD == policy)
+		{
+			for (size_t i = 1; i < io_services.size(); ++i)
+				if (loads[i] < loads[index])
+					index = i;
+		}
+		else
+			index = next_io_service++ % io_services.size();
+
+		++loads[index];
+		return *io_services[index];
+	}
+
+	virtual void release_io_service(boost::asio::io_service& io_service_)
+	{
+		auto iter = std::find(std::begin(io_services), std::end(io_services), &io_service_);
+		if (iter != std::end(io_services))
+			--loads[std::distance(std::begin(io_services), iter)];
+	}
+
+protected:
+	virtual void do_service(int thread_num)
+	{
+		for (auto iter = std::begin(extra_io_services); iter != std::end(extra_io_services); ++iter)
+		{
+			(*iter)->reset(); //this is needed when restart service
+			works.push_back(boost::make_shared<boost::asio::io_service::work>(**iter));
+		}
+
+		st_service_pump::do_service(thread_num);
+
+		size_t index = 0;
+		for (auto iter = std::begin(extra_io_services); iter != std::end(extra_io_services); ++iter)
+		{
+			auto& io_service_ = **iter;
+			auto t = service_threads.create_thread([this, &io_service_]() {ST_THIS run_io_service(io_service_);});
+			if (pin_thread)
+				bind_cpu(*t, ++index);
+		}
+	}
+
+	void run_io_service(boost::asio::io_service& io_service_)
+	{
+		boost::system::error_code ec;
+#ifdef ST_ASIO_ENHANCED_STABILITY
+		while (true)
+		{
+			try {io_service_.run(ec); return;}
+			catch (const std::exception& e) {if (!on_exception(e)) return;}
+		}
+#else
+		io_service_.run(ec);
+#endif
+	}
+
+	static void bind_cpu(boost::thread& t, size_t index)
+	{
+		auto cpu_num = boost::thread::hardware_concurrency();
+		if (0 == cpu_num)
+			return;
+
+		index %= cpu_num;
+#ifdef _WIN32
+		SetThreadAffinityMask(t.native_handle(), (DWORD_PTR) 1 << index);
+#elif defined(__linux__)
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(index, &cpu_set);
+		pthread_setaffinity_np(t.native_handle(), sizeof(cpu_set_t), &cpu_set);
+#endif
+	}
+
+protected:
+	distribution_policy policy;
+	bool pin_thread;
+	st_atomic_size_t next_io_service;
+	boost::scoped_array<st_atomic_size_t> loads;
+
+	std::vector<boost::asio::io_service*> io_services; //include this
+	boost::container::list<boost::shared_ptr<boost::asio::io_service>> extra_io_services;
+	boost::container::list<boost::shared_ptr<boost::asio::io_service::work>> works;
+};
+
 } //namespace
 
 #endif /* ST_ASIO_WRAPPER_SERVICE_PUMP_H_ */
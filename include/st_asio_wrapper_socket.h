@@ -14,6 +14,7 @@
 #define ST_ASIO_WRAPPER_SOCKET_H_
 
 #include "st_asio_wrapper_timer.h"
+#include "st_asio_wrapper_container.h"
 
 //after this duration, this st_socket can be freed from the heap or reused,
 //you must define this macro as a value, not just define it, the value means the duration, unit is second.
@@ -25,6 +26,55 @@
 #endif
 static_assert(ST_ASIO_DELAY_CLOSE >= 0, "delay close duration must be bigger than or equal to zero.");
 
+//if defined, st_socket will dequeue at most ST_ASIO_DISPATCH_BATCH_MSG msgs from the receive buffer under one lock,
+//and dispatch them (via on_msg_handle) in one posted handler, rather than post one handler and lock once per msg.
+//the value is also a fairness cap, after dispatching this number of msgs, the handler will be re-posted to give
+//other st_sockets a chance to be served by this thread.
+//dequeued msgs are no longer counted by the receive buffer (ST_ASIO_MAX_MSG_NUM and the receive water marks), so besides them,
+//a st_socket may hold at most ST_ASIO_DISPATCH_BATCH_MSG more received msgs (without this macro, one more msg).
+//you must define this macro as a value, not just define it.
+//#define ST_ASIO_DISPATCH_BATCH_MSG	32
+#ifdef ST_ASIO_DISPATCH_BATCH_MSG
+static_assert(ST_ASIO_DISPATCH_BATCH_MSG > 0, "dispatch batch size must be bigger than zero.");
+#endif
+
+//define ST_ASIO_WANT_BATCH_MSG_RECV_NOTIFY to get on_msgs() callback, it will be invoked once per read with all msgs unpacked by it
+//(plus msgs left by previous reads), rather than invoke on_msg() once per msg.
+#if defined(ST_ASIO_FORCE_TO_USE_MSG_RECV_BUFFER) && defined(ST_ASIO_WANT_BATCH_MSG_RECV_NOTIFY)
+	#error ST_ASIO_FORCE_TO_USE_MSG_RECV_BUFFER and ST_ASIO_WANT_BATCH_MSG_RECV_NOTIFY cannot be defined at the same time.
+#endif
+
+//safe_send_msg (blocked) and async_send_msg (held) will be resumed when the send buffer's size drops below this value (by send_handler),
+//you must define this macro as a value, not just define it.
+#ifndef ST_ASIO_SEND_BUFFER_LOW_WATER
+#define ST_ASIO_SEND_BUFFER_LOW_WATER	((ST_ASIO_MAX_MSG_NUM + 1) / 2)
+#endif
+static_assert(ST_ASIO_SEND_BUFFER_LOW_WATER > 0 && ST_ASIO_SEND_BUFFER_LOW_WATER <= ST_ASIO_MAX_MSG_NUM, "send buffer low water must be in (0, ST_ASIO_MAX_MSG_NUM].");
+
+//besides ST_ASIO_MAX_MSG_NUM, the send and receive buffers are also limited by their total size in bytes, the following are the default
+//high and low water marks (bytes) of every st_socket, they can be changed per st_socket via send_water_mark() and recv_water_mark().
+//send buffer: msgs will be refused (can_overflow is false) after the high water mark reached, on_send_buffer_high() will be invoked,
+// after send_handler drained the send buffer below the low water mark, on_send_buffer_low() will be invoked.
+//receive buffer: receiving will be paused after the high water mark reached, and be resumed by msg dispatching after the receive buffer been
+// drained below the low water mark, no polling.
+//a msg bigger than the high water mark can still be put into an empty buffer.
+//you must define these macros as values, not just define them.
+#ifndef ST_ASIO_SEND_BUFFER_HIGH_BYTE
+#define ST_ASIO_SEND_BUFFER_HIGH_BYTE	(4 * 1024 * 1024)
+#endif
+#ifndef ST_ASIO_SEND_BUFFER_LOW_BYTE
+#define ST_ASIO_SEND_BUFFER_LOW_BYTE	(ST_ASIO_SEND_BUFFER_HIGH_BYTE / 2)
+#endif
+static_assert(ST_ASIO_SEND_BUFFER_LOW_BYTE > 0 && ST_ASIO_SEND_BUFFER_LOW_BYTE <= ST_ASIO_SEND_BUFFER_HIGH_BYTE, "send buffer water marks are invalid.");
+
+#ifndef ST_ASIO_RECV_BUFFER_HIGH_BYTE
+#define ST_ASIO_RECV_BUFFER_HIGH_BYTE	(4 * 1024 * 1024)
+#endif
+#ifndef ST_ASIO_RECV_BUFFER_LOW_BYTE
+#define ST_ASIO_RECV_BUFFER_LOW_BYTE	(ST_ASIO_RECV_BUFFER_HIGH_BYTE / 2)
+#endif
+static_assert(ST_ASIO_RECV_BUFFER_LOW_BYTE > 0 && ST_ASIO_RECV_BUFFER_LOW_BYTE <= ST_ASIO_RECV_BUFFER_HIGH_BYTE, "receive buffer water marks are invalid.");
+
 namespace st_asio_wrapper
 {
 
@@ -41,9 +91,14 @@ protected:
 	static const tid TIMER_END = TIMER_BEGIN + 10;
 
 	st_socket(boost::asio::io_service& io_service_) : st_timer(io_service_), _id(-1), next_layer_(io_service_), packer_(boost::make_shared<Packer>()),
-		send_atomic(0), dispatch_atomic(0), started_(false), start_atomic(0) {reset_state();}
+		send_atomic(0), dispatch_atomic(0), started_(false), start_atomic(0), send_waiter_num(0), held_send_num(0),
+		send_high_water_(ST_ASIO_SEND_BUFFER_HIGH_BYTE), send_low_water_(ST_ASIO_SEND_BUFFER_LOW_BYTE), send_buffer_high(0),
+		recv_high_water_(ST_ASIO_RECV_BUFFER_HIGH_BYTE), recv_low_water_(ST_ASIO_RECV_BUFFER_LOW_BYTE), recv_buffer_high(0) {reset_state();}
 	template<typename Arg> st_socket(boost::asio::io_service& io_service_, Arg& arg) : st_timer(io_service_), _id(-1), next_layer_(io_service_, arg), packer_(boost::make_shared<Packer>()),
-		send_atomic(0), dispatch_atomic(0), started_(false), start_atomic(0) {reset_state();}
+		send_atomic(0), dispatch_atomic(0), started_(false), start_atomic(0), send_waiter_num(0), held_send_num(0),
+		send_high_water_(ST_ASIO_SEND_BUFFER_HIGH_BYTE), send_low_water_(ST_ASIO_SEND_BUFFER_LOW_BYTE), send_buffer_high(0),
+		recv_high_water_(ST_ASIO_RECV_BUFFER_HIGH_BYTE), recv_low_water_(ST_ASIO_RECV_BUFFER_LOW_BYTE), recv_buffer_high(0) {reset_state();}
+	~st_socket() {clear_held_send_msg();} //a st_socket may be freed without been reused (reset), held msgs must get handler(false) anyway
 
 	void reset()
 	{
@@ -60,22 +115,29 @@ protected:
 
 		sending = paused_sending = false;
 		dispatching = paused_dispatching = congestion_controlling = false;
+		send_buffer_high = recv_buffer_high = 0;
 	}
 
 	void clear_buffer()
 	{
+		clear_held_send_msg();
 		send_msg_buffer.clear();
 		recv_msg_buffer.clear();
 		temp_msg_buffer.clear();
 
+#ifdef ST_ASIO_DISPATCH_BATCH_MSG
+		dispatching_msg_buffer.clear();
+#else
 		last_dispatch_msg.clear();
+#endif
 	}
 
 public:
-	typedef obj_with_begin_time<InMsgType> in_msg;
+	typedef shareable_obj_with_begin_time<InMsgType> in_msg;
 	typedef obj_with_begin_time<OutMsgType> out_msg;
 	typedef InQueue<in_msg, InContainer<in_msg>> in_container_type;
 	typedef OutQueue<out_msg, OutContainer<out_msg>> out_container_type;
+	typedef boost::container::list<out_msg> recv_container_type; //the type of temp_msg_buffer
 
 	uint_fast64_t id() const {return _id;}
 	bool is_equal_to(uint_fast64_t id) const {return _id == id;}
@@ -129,9 +191,7 @@ public:
 
 	//in st_asio_wrapper, it's thread safe to access stat without mutex, because for a specific member of stat, st_asio_wrapper will never access it concurrently.
 	//in other words, in a specific thread, st_asio_wrapper just access only one member of stat.
-	//but user can access stat out of st_asio_wrapper via get_statistic function, although user can only read it, there's still a potential risk,
-	//so whether it's thread safe or not depends on std::chrono::system_clock::duration.
-	//i can make it thread safe in st_asio_wrapper, but is it worth to do so? this is a problem.
+	//all members of stat are lock-free atomic counters (see stat_counter), so user can read stat via get_statistic function in any thread safely.
 	const struct statistic& get_statistic() const {return stat;}
 
 	//get or change the packer at runtime
@@ -143,22 +203,88 @@ public:
 
 	//if you use can_overflow = true to invoke send_msg or send_native_msg, it will always succeed no matter the sending buffer is available or not,
 	//this can exhaust all virtual memory, please pay special attentions.
-	bool is_send_buffer_available() const {return send_msg_buffer.size() < ST_ASIO_MAX_MSG_NUM;}
+	bool is_send_buffer_available() const {return send_msg_buffer.size() < ST_ASIO_MAX_MSG_NUM && send_msg_buffer.size_in_byte() < send_high_water_;}
+	bool is_recv_buffer_available() const {return recv_msg_buffer.size() < ST_ASIO_MAX_MSG_NUM && recv_msg_buffer.size_in_byte() < recv_high_water_;}
+
+	//change the high and low water marks (bytes) of the send or receive buffer, see ST_ASIO_SEND_BUFFER_HIGH_BYTE for more details.
+	//not thread-safe, please call them before this st_socket been started (in reset() for example).
+	void send_water_mark(size_t high, size_t low) {assert(low > 0 && low <= high); send_high_water_ = high; send_low_water_ = low;}
+	size_t send_high_water() const {return send_high_water_;}
+	size_t send_low_water() const {return send_low_water_;}
+	void recv_water_mark(size_t high, size_t low) {assert(low > 0 && low <= high); recv_high_water_ = high; recv_low_water_ = low;}
+	size_t recv_high_water() const {return recv_high_water_;}
+	size_t recv_low_water() const {return recv_low_water_;}
 
 	//don't use the packer but insert into send buffer directly
 	bool direct_send_msg(const InMsgType& msg, bool can_overflow = false) {return direct_send_msg(InMsgType(msg), can_overflow);}
 	bool direct_send_msg(InMsgType&& msg, bool can_overflow = false) {return can_overflow || is_send_buffer_available() ? do_direct_send_msg(std::move(msg)) : false;}
+	//share an immutable packed msg with other st_sockets instead of copying it (used by broadcasting, see TCP_SHARED_BROADCAST_MSG),
+	//the msg must not be changed after been shared.
+	bool direct_send_shared_msg(const boost::shared_ptr<const InMsgType>& msg, bool can_overflow = false)
+	{
+		static_assert(std::is_copy_constructible<InMsgType>::value, "shared msgs must be copyable, see shareable_obj_with_begin_time::materialize.");
+		return msg && (can_overflow || is_send_buffer_available()) ? do_direct_send_msg(in_msg(msg)) : false;
+	}
+
+	//never fail and never block, if the send buffer is available (and no msgs are being held), msg will be put into it and handler(true) will be invoked
+	//immediately (in the calling thread), otherwise, msg will be held until the send buffer been drained below its low water marks,
+	//then be put into the send buffer and handler(true) will be invoked in a service thread. held msgs keep their order.
+	//if this st_socket been closed before msg been put into the send buffer, msg will be dropped and handler(false) will be invoked,
+	//msgs that need to be held when this st_socket is not started (been closed for example) will be dropped immediately (handler(false) too).
+	//unlike safe_send_msg, it can be used in service threads (in on_msg_handle for example).
+	void async_direct_send_msg(const InMsgType& msg, const std::function<void(bool)>& handler = std::function<void(bool)>())
+		{async_direct_send_msg(InMsgType(msg), handler);}
+	void async_direct_send_msg(InMsgType&& msg, const std::function<void(bool)>& handler = std::function<void(bool)>())
+	{
+		if (msg.empty())
+		{
+			if (handler)
+				handler(true);
+			return;
+		}
+
+		boost::unique_lock<boost::mutex> lock(held_send_mutex);
+		if (held_send_buffer.empty() && is_send_buffer_available())
+		{
+			enqueue_send_msg(std::move(msg));
+			lock.unlock();
+
+			send_msg();
+			if (handler)
+				handler(true);
+		}
+		else if (!started()) //close() drops held msgs under held_send_mutex after clearing started_, a msg held now would never be released
+		{
+			lock.unlock();
+
+			if (handler)
+				handler(false);
+		}
+		else
+		{
+			held_send_buffer.emplace_back(std::move(msg), handler);
+			++held_send_num;
+			lock.unlock();
+
+			//the send buffer may have been drained before msg was held, in which case no send_handler will release it
+			if (is_send_buffer_available())
+				release_held_send_msg();
+		}
+	}
 
 	//how many msgs waiting for sending or dispatching
 	GET_PENDING_MSG_NUM(get_pending_send_msg_num, send_msg_buffer)
 	GET_PENDING_MSG_NUM(get_pending_recv_msg_num, recv_msg_buffer)
 
-	POP_FIRST_PENDING_MSG(pop_first_pending_send_msg, send_msg_buffer, in_msg)
-	POP_FIRST_PENDING_MSG(pop_first_pending_recv_msg, recv_msg_buffer, out_msg)
+	void pop_first_pending_send_msg(in_msg& msg) {msg.clear(); if (send_msg_buffer.try_dequeue(msg)) msg.materialize();}
+	//popping received msgs drains the receive buffer as dispatching does, so receiving will be resumed if it was paused by the high water mark.
+	void pop_first_pending_recv_msg(out_msg& msg) {msg.clear(); if (recv_msg_buffer.try_dequeue(msg)) check_recv_buffer();}
 
 	//clear all pending msgs
+	//notice: popped send msgs may be shared with other st_sockets (see direct_send_shared_msg), only access them via data() and size(),
+	//or call materialize() first to get a private copy.
 	POP_ALL_PENDING_MSG(pop_all_pending_send_msg, send_msg_buffer, in_container_type)
-	POP_ALL_PENDING_MSG(pop_all_pending_recv_msg, recv_msg_buffer, out_container_type)
+	void pop_all_pending_recv_msg(out_container_type& msg_queue) {msg_queue.clear(); recv_msg_buffer.swap(msg_queue); check_recv_buffer();}
 
 protected:
 	virtual bool do_start() = 0;
@@ -191,6 +317,34 @@ protected:
 	virtual bool on_msg(OutMsgType& msg) = 0;
 #endif
 
+#ifdef ST_ASIO_WANT_BATCH_MSG_RECV_NOTIFY
+	//all msgs unpacked from one read, in receiving order, only be invoked when msg dispatching not suspended and congestion control closed.
+	//remove msgs that have been handled from msg_can, left msgs will be put into the receive buffer and dispatched via on_msg_handle() in their original order,
+	//but if msg dispatching been suspended or congestion control been opened during this call, left msgs will stay in msg_can and be passed to on_msgs() again later.
+	//the default implementation just invokes on_msg() for each msg until msg dispatching suspended or congestion control opened (like on_msg() without this macro),
+	//msgs which on_msg() returned false will be put into the receive buffer, overwrite it to handle msgs in batch (for example, forward them to a DB writer at once).
+	//notice: on_msg_handle() will not be invoked from within this function
+	//
+	//notice: msgs are unpacked, using inconstant is for the convenience of swapping
+	virtual void on_msgs(recv_container_type& msg_can)
+	{
+		recv_container_type rejected_can;
+		for (auto iter = std::begin(msg_can); !paused_dispatching && !congestion_controlling && iter != std::end(msg_can);)
+			if (on_msg(*iter))
+				msg_can.erase(iter++);
+			else
+				rejected_can.splice(std::end(rejected_can), msg_can, iter++);
+
+		if (!paused_dispatching && !congestion_controlling) //all msgs been passed to on_msg(), handle_msg() will put rejected msgs into the receive buffer
+			msg_can.splice(std::end(msg_can), rejected_can);
+		else if (!rejected_can.empty()) //stopped, left msgs will stay in msg_can, but don't pass rejected msgs to on_msg() again
+		{
+			recv_msg_buffer.move_items_in(rejected_can);
+			dispatch_msg();
+		}
+	}
+#endif
+
 	//handling msg in om_msg_handle() will not block msg receiving on the same st_socket
 	//return true means msg been handled, false means msg cannot be handled right now, and st_socket will re-dispatch it asynchronously
 	//if link_down is true, no matter return true or false, st_socket will not maintain this msg anymore, and continue dispatch the next msg continuously
@@ -209,12 +363,20 @@ protected:
 	virtual void on_all_msg_send(InMsgType& msg) {}
 #endif
 
+	//the send buffer's size (bytes) reached the high water mark, msgs will be refused (unless can_overflow is true) until the send buffer
+	//been drained below it, then on_send_buffer_low() will be invoked after the send buffer been drained below the low water mark.
+	//they're invoked alternately, on_send_buffer_high() in the sending thread and on_send_buffer_low() in a service thread.
+	//notice: do not send msgs in these callbacks.
+	virtual void on_send_buffer_high() {}
+	virtual void on_send_buffer_low() {}
+
 	//subclass notify shutdown event, not thread safe
 	void close()
 	{
 		if (started_)
 		{
 			started_ = false;
+			clear_held_send_msg();
 
 			if (is_closable())
 			{
@@ -228,11 +390,20 @@ protected:
 	//subclasses must guarantee not call this function in more than one thread concurrently.
 	void handle_msg()
 	{
-#ifndef ST_ASIO_FORCE_TO_USE_MSG_RECV_BUFFER
+#ifdef ST_ASIO_WANT_BATCH_MSG_RECV_NOTIFY
 		decltype(temp_msg_buffer) temp_buffer;
 		if (!temp_msg_buffer.empty() && !paused_dispatching && !congestion_controlling)
 		{
-			auto_duration(stat.handle_time_1_sum);
+			auto_duration dur(stat.handle_time_1_sum);
+			on_msgs(temp_msg_buffer);
+			if (!paused_dispatching && !congestion_controlling) //otherwise, left msgs stay in temp_msg_buffer, just like on_msg()
+				temp_buffer.splice(std::end(temp_buffer), temp_msg_buffer);
+		}
+#elif !defined(ST_ASIO_FORCE_TO_USE_MSG_RECV_BUFFER)
+		decltype(temp_msg_buffer) temp_buffer;
+		if (!temp_msg_buffer.empty() && !paused_dispatching && !congestion_controlling)
+		{
+			auto_duration dur(stat.handle_time_1_sum);
 			for (auto iter = std::begin(temp_msg_buffer); !paused_dispatching && !congestion_controlling && iter != std::end(temp_msg_buffer);)
 				if (on_msg(*iter))
 					temp_msg_buffer.erase(iter++);
@@ -249,8 +420,14 @@ protected:
 			dispatch_msg();
 		}
 
-		if (temp_msg_buffer.empty() && recv_msg_buffer.size() < ST_ASIO_MAX_MSG_NUM)
+		if (temp_msg_buffer.empty() && is_recv_buffer_available())
 			do_recv_msg(); //receive msg sequentially, which means second receiving only after first receiving success
+		else if (temp_msg_buffer.empty()) //the receive buffer reached its high water mark, msg dispatching will resume receiving
+		{
+			recv_idle_begin_time = statistic::local_time();
+			recv_buffer_high = 1;
+			check_recv_buffer(); //the receive buffer may have been drained already
+		}
 		else
 		{
 			recv_idle_begin_time = statistic::local_time();
@@ -285,11 +462,16 @@ protected:
 		else if (stopped())
 		{
 #ifndef ST_ASIO_DISCARD_MSG_WHEN_LINK_DOWN
+#ifdef ST_ASIO_DISPATCH_BATCH_MSG
+			for (; !dispatching_msg_buffer.empty(); dispatching_msg_buffer.pop_front())
+				on_msg_handle(dispatching_msg_buffer.front(), true);
+#else
 			if (!last_dispatch_msg.empty())
 			{
 				on_msg_handle(last_dispatch_msg, true);
 				last_dispatch_msg.clear();
 			}
+#endif
 
 			out_msg msg;
 			typename out_container_type::lock_guard lock(recv_msg_buffer);
@@ -297,27 +479,145 @@ protected:
 				on_msg_handle(msg, true);
 #endif
 		}
+#ifdef ST_ASIO_DISPATCH_BATCH_MSG
+		else
+		{
+			if (dispatching_msg_buffer.empty())
+			{
+				out_msg msg;
+				typename out_container_type::lock_guard lock(recv_msg_buffer);
+				for (size_t i = 0; i < ST_ASIO_DISPATCH_BATCH_MSG && recv_msg_buffer.try_dequeue_(msg); ++i)
+					dispatching_msg_buffer.push_back(std::move(msg));
+			}
+			check_recv_buffer();
+
+			if (!dispatching_msg_buffer.empty())
+			{
+				post([this]() {ST_THIS msg_handler();});
+				return true;
+			}
+		}
+#else
 		else if (!last_dispatch_msg.empty() || recv_msg_buffer.try_dequeue(last_dispatch_msg))
 		{
+			check_recv_buffer();
 			post([this]() {ST_THIS msg_handler();});
 			return true;
 		}
+#endif
 
 		return false;
 	}
 
-	bool do_direct_send_msg(InMsgType&& msg)
+	//resume receiving if it was paused by the receive buffer's high water mark and the receive buffer been drained below the low water mark.
+	void check_recv_buffer()
+	{
+		if (recv_buffer_high && recv_msg_buffer.size_in_byte() < recv_low_water_ && recv_msg_buffer.size() < ST_ASIO_MAX_MSG_NUM && 1 == recv_buffer_high.exchange(0))
+			post([this]() {
+				if (ST_THIS started())
+				{
+					ST_THIS stat.recv_idle_sum += statistic::local_time() - ST_THIS recv_idle_begin_time;
+					ST_THIS handle_msg();
+				}
+			});
+	}
+
+	//call this in subclasses' send_handler only (after msgs been dequeued from the send buffer), invoke on_send_buffer_low(),
+	//wake up safe_send_msg and release msgs held by async_send_msg if the send buffer been drained below its low water marks.
+	void check_send_buffer()
+	{
+		auto size_in_byte = send_msg_buffer.size_in_byte();
+		if (send_buffer_high && size_in_byte < send_low_water_ && 1 == send_buffer_high.exchange(0))
+			on_send_buffer_low();
+
+		if (send_msg_buffer.size() >= ST_ASIO_SEND_BUFFER_LOW_WATER || size_in_byte >= send_low_water_)
+			return;
+
+		if (send_waiter_num > 0)
+		{
+			boost::unique_lock<boost::mutex> lock(send_waiter_mutex);
+			send_waiter_cond.notify_all();
+		}
+
+		if (held_send_num > 0)
+			release_held_send_msg();
+	}
+
+	//used by safe_send_msg, block until send_handler drains the send buffer below its low water marks,
+	//or 50 milliseconds elapsed (so shutting down or suspended sending can be noticed by the caller).
+	void wait_send_buffer()
+	{
+		boost::unique_lock<boost::mutex> lock(send_waiter_mutex);
+		++send_waiter_num;
+		if (!is_send_buffer_available())
+			send_waiter_cond.timed_wait(lock, boost::posix_time::milliseconds(50));
+		--send_waiter_num;
+	}
+
+	bool do_direct_send_msg(in_msg&& msg)
 	{
 		if (!msg.empty())
 		{
-			send_msg_buffer.enqueue(in_msg(std::move(msg)));
+			enqueue_send_msg(std::move(msg));
 			send_msg();
 		}
 
 		return true;
 	}
 
+	//put msg into the send buffer, invoke on_send_buffer_high() if the send buffer will reach its high water mark.
+	//check before enqueuing, so send_handler will not miss the chance to invoke on_send_buffer_low().
+	void enqueue_send_msg(in_msg&& msg)
+	{
+		if (!send_buffer_high && send_msg_buffer.size_in_byte() + msg.size() >= send_high_water_ && 0 == send_buffer_high.exchange(1))
+			on_send_buffer_high();
+		send_msg_buffer.enqueue(std::move(msg));
+	}
+
 private:
+	struct held_msg
+	{
+		held_msg(InMsgType&& msg_, const std::function<void(bool)>& handler_) : msg(std::move(msg_)), handler(handler_) {}
+		held_msg(held_msg&& other) : msg(std::move(other.msg)), handler(std::move(other.handler)) {}
+
+		InMsgType msg;
+		std::function<void(bool)> handler;
+	};
+
+	void release_held_send_msg()
+	{
+		boost::container::list<held_msg> released;
+		boost::unique_lock<boost::mutex> lock(held_send_mutex);
+		while (!held_send_buffer.empty() && is_send_buffer_available())
+		{
+			enqueue_send_msg(std::move(held_send_buffer.front().msg)); //under held_send_mutex to keep the order with async_direct_send_msg
+			released.splice(std::end(released), held_send_buffer, std::begin(held_send_buffer));
+			--held_send_num;
+		}
+		lock.unlock();
+
+		if (!released.empty())
+		{
+			send_msg();
+			for (auto iter = std::begin(released); iter != std::end(released); ++iter)
+				if (iter->handler)
+					iter->handler(true);
+		}
+	}
+
+	void clear_held_send_msg()
+	{
+		boost::container::list<held_msg> dropped;
+		boost::unique_lock<boost::mutex> lock(held_send_mutex);
+		dropped.swap(held_send_buffer);
+		held_send_num = 0;
+		lock.unlock();
+
+		for (auto iter = std::begin(dropped); iter != std::end(dropped); ++iter)
+			if (iter->handler)
+				iter->handler(false);
+	}
+
 	//please do not change id at runtime via the following function, except this st_socket is not managed by st_object_pool,
 	//it should only be used by st_object_pool when reusing or creating new st_socket.
 	template<typename Object> friend class st_object_pool;
@@ -356,6 +656,28 @@ private:
 
 	void msg_handler()
 	{
+#ifdef ST_ASIO_DISPATCH_BATCH_MSG
+		auto re = true;
+		auto begin_time = statistic::local_time(), end_time = begin_time;
+		while (!paused_dispatching && !dispatching_msg_buffer.empty())
+		{
+			auto& msg = dispatching_msg_buffer.front();
+			stat.dispatch_dealy_sum += begin_time - msg.begin_time;
+			re = on_msg_handle(msg, false); //must before next msg dispatching to keep sequence
+			end_time = statistic::local_time();
+			stat.handle_time_2_sum += end_time - begin_time;
+
+			if (!re)
+				break;
+
+			dispatching_msg_buffer.pop_front();
+			begin_time = end_time;
+		}
+
+		if (!re) //dispatch failed, re-dispatch, the failed msg is still at the front of dispatching_msg_buffer
+		{
+			dispatching_msg_buffer.front().restart(end_time);
+#else
 		auto begin_time = statistic::local_time();
 		stat.dispatch_dealy_sum += begin_time - last_dispatch_msg.begin_time;
 		bool re = on_msg_handle(last_dispatch_msg, false); //must before next msg dispatching to keep sequence
@@ -365,12 +687,15 @@ private:
 		if (!re) //dispatch failed, re-dispatch
 		{
 			last_dispatch_msg.restart(end_time);
+#endif
 			dispatching = false;
 			set_timer(TIMER_DISPATCH_MSG, 50, [this](tid id)->bool {return ST_THIS timer_handler(id);});
 		}
 		else //dispatch msg sequentially, which means second dispatching only after first dispatching success
 		{
+#ifndef ST_ASIO_DISPATCH_BATCH_MSG
 			last_dispatch_msg.clear();
+#endif
 			if (!do_dispatch_msg())
 			{
 				dispatching = false;
@@ -384,12 +709,16 @@ protected:
 	uint_fast64_t _id;
 	Socket next_layer_;
 
+#ifdef ST_ASIO_DISPATCH_BATCH_MSG
+	ring_buffer<out_msg> dispatching_msg_buffer; //msgs dequeued from recv_msg_buffer but not yet dispatched, only accessed by the dispatching thread
+#else
 	out_msg last_dispatch_msg;
+#endif
 	boost::shared_ptr<i_packer<typename Packer::msg_type>> packer_;
 
 	in_container_type send_msg_buffer;
 	out_container_type recv_msg_buffer;
-	boost::container::list<out_msg> temp_msg_buffer;
+	recv_container_type temp_msg_buffer;
 	//subclass will invoke handle_msg() when got some msgs. if these msgs can't be pushed into recv_msg_buffer because of:
 	// 1. msg dispatching suspended;
 	// 2. congestion control opened;
@@ -403,6 +732,19 @@ protected:
 	bool started_; //has started or not
 	st_atomic_size_t start_atomic;
 
+	st_atomic_size_t send_waiter_num; //how many threads are blocked in safe_send_msg
+	boost::mutex send_waiter_mutex;
+	boost::condition_variable send_waiter_cond;
+
+	boost::container::list<held_msg> held_send_buffer; //msgs held by async_send_msg because the send buffer was not available
+	st_atomic_size_t held_send_num;
+	boost::mutex held_send_mutex;
+
+	size_t send_high_water_, send_low_water_;
+	st_atomic_size_t send_buffer_high; //on_send_buffer_high() has been invoked but on_send_buffer_low() not yet
+	size_t recv_high_water_, recv_low_water_;
+	st_atomic_size_t recv_buffer_high; //receiving has been paused by the receive buffer's high water mark
+
 	struct statistic stat;
 	typename statistic::stat_time recv_idle_begin_time;
 };
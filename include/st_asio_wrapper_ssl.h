@@ -211,27 +211,14 @@ protected:
 		}
 	}
 
-	virtual void start_next_accept()
+	virtual void handle_accepted(typename st_ssl_server_base::object_ctype& client_ptr)
 	{
-		auto client_ptr = ST_THIS create_object(*this);
-		ST_THIS acceptor.async_accept(client_ptr->lowest_layer(), [client_ptr, this](const boost::system::error_code& ec) {ST_THIS accept_handler(ec, client_ptr);});
+		if (ST_THIS on_accept(client_ptr))
+			client_ptr->next_layer().async_handshake(boost::asio::ssl::stream_base::server,
+				[client_ptr, this](const boost::system::error_code& ec) {ST_THIS handshake_handler(ec, client_ptr);});
 	}
 
 private:
-	void accept_handler(const boost::system::error_code& ec, typename st_ssl_server_base::object_ctype& client_ptr)
-	{
-		if (!ec)
-		{
-			if (ST_THIS on_accept(client_ptr))
-				client_ptr->next_layer().async_handshake(boost::asio::ssl::stream_base::server,
-					[client_ptr, this](const boost::system::error_code& ec) {ST_THIS handshake_handler(ec, client_ptr);});
-
-			start_next_accept();
-		}
-		else
-			ST_THIS stop_listen();
-	}
-
 	void handshake_handler(const boost::system::error_code& ec, typename st_ssl_server_base::object_ctype& client_ptr)
 	{
 		on_handshake(ec, client_ptr);
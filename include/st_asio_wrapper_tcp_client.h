@@ -61,6 +61,18 @@ public:
 	//success at here just means put the msg into st_tcp_socket_base's send buffer
 	TCP_BROADCAST_MSG(safe_broadcast_msg, safe_send_msg)
 	TCP_BROADCAST_MSG(safe_broadcast_native_msg, safe_send_native_msg)
+	//pack only once (outside the pool's lock) and share the packed msg among all st_sockets without copying its content
+	TCP_SHARED_BROADCAST_MSG(shared_broadcast_msg, false)
+	TCP_SHARED_BROADCAST_MSG(shared_broadcast_native_msg, true)
+	TCP_DIRECT_BROADCAST_MSG(direct_broadcast_msg)
+	//like shared_broadcast_msg, but put the packed msg into send buffers in service threads concurrently and returns immediately
+	TCP_PARALLEL_BROADCAST_MSG(parallel_broadcast_msg, false)
+	TCP_PARALLEL_BROADCAST_MSG(parallel_broadcast_native_msg, true)
+	TCP_PARALLEL_DIRECT_BROADCAST_MSG(parallel_direct_broadcast_msg)
+	//pack only once and send the msg to all st_sockets in a group (see st_object_pool::join_group)
+	TCP_GROUP_SEND_MSG(group_send_msg, false)
+	TCP_GROUP_SEND_MSG(group_send_native_msg, true)
+	TCP_DIRECT_GROUP_SEND_MSG(direct_group_send_msg)
 	//msg sending interface
 	///////////////////////////////////////////////////
 
@@ -22,9 +22,53 @@
 #endif
 static_assert(ST_ASIO_GRACEFUL_SHUTDOWN_MAX_DURATION > 0, "graceful shutdown duration must be bigger than zero.");
 
+//how many bytes and msgs can be gathered into one async_write at most (the first msg will always be sent no matter how big it is),
+//they can be changed at runtime for each st_tcp_socket via max_send_size() and max_send_num().
+#ifndef ST_ASIO_MAX_SEND_SIZE
+#define ST_ASIO_MAX_SEND_SIZE	boost::asio::detail::default_max_transfer_size
+#endif
+#ifndef ST_ASIO_MAX_SEND_NUM
+#define ST_ASIO_MAX_SEND_NUM	ST_ASIO_MAX_MSG_NUM
+#endif
+static_assert(ST_ASIO_MAX_SEND_NUM > 0, "the maximum msg number per async_write must be bigger than zero.");
+
+//if no data arrived for this number of seconds, an st_tcp_socket releases its receive buffer (see i_unpacker::releasable() and release_buffer()),
+//to make this possible, when there's no half-baked msg in the receive buffer, st_tcp_socket waits for the socket to become readable (without
+//any buffer) before reading, so the buffer is not held by asio while the session is idle, this costs one more async operation per read.
+//only plain TCP does this, SSL may have decrypted data buffered (the socket will not become readable), so it always reads directly.
+//0 means never release receive buffers (always read directly).
+#ifndef ST_ASIO_RECV_BUFFER_RELEASE_INTERVAL
+#define ST_ASIO_RECV_BUFFER_RELEASE_INTERVAL	10 //seconds
+#endif
+static_assert(ST_ASIO_RECV_BUFFER_RELEASE_INTERVAL >= 0, "receive buffer release interval must be bigger than or equal to zero.");
+
+//define ST_ASIO_WANT_BATCH_MSG_SEND_NOTIFY to get on_msgs_send() callback, it will be invoked once per async_write with all msgs sent by it,
+//unlike ST_ASIO_WANT_MSG_SEND_NOTIFY, msgs batching (see ST_ASIO_MAX_SEND_SIZE and ST_ASIO_MAX_SEND_NUM) still takes effect.
+#if defined(ST_ASIO_WANT_MSG_SEND_NOTIFY) && defined(ST_ASIO_WANT_BATCH_MSG_SEND_NOTIFY)
+	#error ST_ASIO_WANT_MSG_SEND_NOTIFY and ST_ASIO_WANT_BATCH_MSG_SEND_NOTIFY cannot be defined at the same time.
+#endif
+
 namespace st_asio_wrapper
 {
 
+//a const buffer sequence which refers to (not copies) a container of buffers, so, asio will not copy the container itself when
+//async_write stores the buffer sequence, the container must keep unchanged until the write operation completes.
+template<typename Buffers>
+class buffers_ref
+{
+public:
+	typedef typename Buffers::value_type value_type;
+	typedef typename Buffers::const_iterator const_iterator;
+
+	buffers_ref(const Buffers& buffers_) : buffers(&buffers_) {}
+
+	const_iterator begin() const {return std::begin(*buffers);}
+	const_iterator end() const {return std::end(*buffers);}
+
+private:
+	const Buffers* buffers;
+};
+
 template <typename Socket, typename Packer, typename Unpacker,
 	template<typename, typename> class InQueue, template<typename> class InContainer,
 	template<typename, typename> class OutQueue, template<typename> class OutContainer>
@@ -35,23 +79,28 @@ public:
 	typedef typename Packer::msg_ctype in_msg_ctype;
 	typedef typename Unpacker::msg_type out_msg_type;
 	typedef typename Unpacker::msg_ctype out_msg_ctype;
+	typedef InContainer<shareable_obj_with_begin_time<in_msg_type>> sent_container_type; //the type of last_send_msg
 
 protected:
 	typedef st_socket<Socket, Packer, Unpacker, typename Packer::msg_type, typename Unpacker::msg_type, InQueue, InContainer, OutQueue, OutContainer> super;
-	using super::TIMER_BEGIN;
-	using super::TIMER_END;
+
+	static const st_timer::tid TIMER_BEGIN = super::TIMER_END;
+	static const st_timer::tid TIMER_RELEASE_RECV_BUFFER = TIMER_BEGIN;
+	static const st_timer::tid TIMER_END = TIMER_BEGIN + 10;
 
 	enum shutdown_states {NONE, FORCE, GRACEFUL};
 
-	st_tcp_socket_base(boost::asio::io_service& io_service_) : super(io_service_), unpacker_(boost::make_shared<Unpacker>()), shutdown_state(NONE), shutdown_atomic(0) {}
+	st_tcp_socket_base(boost::asio::io_service& io_service_) : super(io_service_), max_send_size_(ST_ASIO_MAX_SEND_SIZE), max_send_num_(ST_ASIO_MAX_SEND_NUM),
+		unpacker_(boost::make_shared<Unpacker>()), shutdown_state(NONE), shutdown_atomic(0), recv_waiting(false), recv_wait_num(0), checked_wait_num(0), release_timer_set(false) {}
 	template<typename Arg>
-	st_tcp_socket_base(boost::asio::io_service& io_service_, Arg& arg) : super(io_service_, arg), unpacker_(boost::make_shared<Unpacker>()), shutdown_state(NONE), shutdown_atomic(0) {}
+	st_tcp_socket_base(boost::asio::io_service& io_service_, Arg& arg) : super(io_service_, arg), max_send_size_(ST_ASIO_MAX_SEND_SIZE), max_send_num_(ST_ASIO_MAX_SEND_NUM),
+		unpacker_(boost::make_shared<Unpacker>()), shutdown_state(NONE), shutdown_atomic(0), recv_waiting(false), recv_wait_num(0), checked_wait_num(0), release_timer_set(false) {}
 
 public:
 	virtual bool obsoleted() {return !is_shutting_down() && super::obsoleted();}
 
 	//reset all, be ensure that there's no any operations performed on this st_tcp_socket_base when invoke it
-	void reset() {reset_state(); shutdown_state = NONE; super::reset();}
+	void reset() {reset_state(); shutdown_state = NONE; release_timer_set = false; super::reset();}
 	void reset_state()
 	{
 		unpacker_->reset_state();
@@ -60,6 +109,13 @@ public:
 
 	bool is_shutting_down() const {return NONE != shutdown_state;}
 
+	//how many bytes and msgs can be gathered into one async_write at most, see ST_ASIO_MAX_SEND_SIZE and ST_ASIO_MAX_SEND_NUM for more details.
+	//not thread safe, but it's harmless, the new value will take effect from the next async_write.
+	size_t max_send_size() const {return max_send_size_;}
+	void max_send_size(size_t _max_send_size) {max_send_size_ = _max_send_size;}
+	size_t max_send_num() const {return max_send_num_;}
+	void max_send_num(size_t _max_send_num) {assert(_max_send_num > 0); max_send_num_ = std::max((size_t) 1, _max_send_num);}
+
 	//get or change the unpacker at runtime
 	//changing unpacker at runtime is not thread-safe, this operation can only be done in on_msg(), reset() or constructor, please pay special attention
 	//we can resolve this defect via mutex, but i think it's not worth, because this feature is not frequently used
@@ -76,6 +132,9 @@ public:
 	//success at here just means put the msg into st_tcp_socket_base's send buffer
 	TCP_SAFE_SEND_MSG(safe_send_msg, send_msg)
 	TCP_SAFE_SEND_MSG(safe_send_native_msg, send_native_msg)
+	//never block, can be used in service threads
+	TCP_ASYNC_SEND_MSG(async_send_msg, false)
+	TCP_ASYNC_SEND_MSG(async_send_native_msg, true)
 	//msg sending interface
 	///////////////////////////////////////////////////
 
@@ -117,12 +176,11 @@ protected:
 	{
 		if (is_send_allowed() && !ST_THIS stopped() && !ST_THIS send_msg_buffer.empty())
 		{
-			std::vector<boost::asio::const_buffer> bufs;
 			{
 #ifdef ST_ASIO_WANT_MSG_SEND_NOTIFY
 				const size_t max_send_size = 0;
 #else
-				const size_t max_send_size = boost::asio::detail::default_max_transfer_size;
+				const size_t max_send_size = max_send_size_;
 #endif
 				size_t size = 0;
 				typename super::in_msg msg;
@@ -134,16 +192,19 @@ protected:
 					ST_THIS stat.send_delay_sum += end_time - msg.begin_time;
 					size += msg.size();
 					last_send_msg.push_back(std::move(msg));
-					bufs.push_back(boost::asio::buffer(last_send_msg.back().data(), last_send_msg.back().size()));
-					if (size >= max_send_size)
+					if (size >= max_send_size || last_send_msg.size() >= max_send_num_)
 						break;
 				}
 			}
 
-			if (!bufs.empty())
+			if (!last_send_msg.empty())
 			{
+				//collect buffers after all msgs been moved in, because containers like ring_buffer may relocate their items while growing
+				for (auto& item : last_send_msg)
+					send_bufs.push_back(boost::asio::buffer(item.data(), item.size()));
+
 				last_send_msg.front().restart();
-				boost::asio::async_write(ST_THIS next_layer(), bufs,
+				boost::asio::async_write(ST_THIS next_layer(), buffers_ref<decltype(send_bufs)>(send_bufs),
 					ST_THIS make_handler_error_size([this](const boost::system::error_code& ec, size_t bytes_transferred) {ST_THIS send_handler(ec, bytes_transferred);}));
 
 				return true;
@@ -154,6 +215,18 @@ protected:
 	}
 
 	virtual void do_recv_msg()
+	{
+#if ST_ASIO_RECV_BUFFER_RELEASE_INTERVAL > 0
+		if (std::is_same<Socket, boost::asio::ip::tcp::socket>::value && unpacker_->releasable())
+		{
+			wait_readable();
+			return;
+		}
+#endif
+		do_read();
+	}
+
+	void do_read()
 	{
 		auto recv_buff = unpacker_->prepare_next_recv();
 		assert(boost::asio::buffer_size(recv_buff) > 0);
@@ -176,6 +249,13 @@ protected:
 
 	virtual bool on_msg_handle(out_msg_type& msg, bool link_down) {unified_out::debug_out("recv(" ST_ASIO_SF "): %s", msg.size(), msg.data()); return true;}
 
+#ifdef ST_ASIO_WANT_BATCH_MSG_SEND_NOTIFY
+	//all msgs sent by one async_write have been sent to the kernel buffer, they're in sending order.
+	//you can move msgs out (to re-send them for example), but do not add or remove items, st_tcp_socket will clear msg_can after this callback.
+	//notice: msgs are packed, using inconstant is for the convenience of swapping
+	virtual void on_msgs_send(sent_container_type& msg_can) {}
+#endif
+
 	void shutdown()
 	{
 		scope_atomic_lock<> lock(shutdown_atomic);
@@ -184,6 +264,7 @@ protected:
 
 		shutdown_state = FORCE;
 		ST_THIS stop_all_timer();
+		release_timer_set = false;
 
 		if (ST_THIS lowest_layer().is_open())
 		{
@@ -197,7 +278,7 @@ protected:
 private:
 	size_t completion_checker(const boost::system::error_code& ec, size_t bytes_transferred)
 	{
-		auto_duration dur(ST_THIS stat.unpack_time_sum);
+		auto_duration dur(static_cast<statistic::duration_sum&>(ST_THIS stat.unpack_time_sum)); //only parse_msg will be sampled into the histogram
 		return ST_THIS unpacker_->completion_condition(ec, bytes_transferred);
 	}
 
@@ -234,6 +315,58 @@ private:
 			ST_THIS on_recv_error(ec);
 	}
 
+#if ST_ASIO_RECV_BUFFER_RELEASE_INTERVAL > 0
+	//wait for the socket to become readable without holding the receive buffer, so it can be released by release_recv_buffer().
+	void wait_readable()
+	{
+		boost::unique_lock<boost::mutex> lock(recv_wait_mutex);
+		recv_waiting = true;
+		++recv_wait_num;
+		lock.unlock();
+
+		if (!release_timer_set)
+		{
+			release_timer_set = true;
+			ST_THIS set_timer(TIMER_RELEASE_RECV_BUFFER, ST_ASIO_RECV_BUFFER_RELEASE_INTERVAL * 1000, [this](st_timer::tid id)->bool {return ST_THIS release_recv_buffer();});
+		}
+
+#if BOOST_VERSION >= 106600
+		ST_THIS lowest_layer().async_wait(boost::asio::ip::tcp::socket::wait_read,
+			ST_THIS make_handler_error([this](const boost::system::error_code& ec) {ST_THIS wait_handler(ec);}));
+#else
+		ST_THIS lowest_layer().async_read_some(boost::asio::null_buffers(),
+			ST_THIS make_handler_error_size([this](const boost::system::error_code& ec, size_t bytes_transferred) {ST_THIS wait_handler(ec);}));
+#endif
+	}
+
+	void wait_handler(const boost::system::error_code& ec)
+	{
+		boost::unique_lock<boost::mutex> lock(recv_wait_mutex);
+		recv_waiting = false;
+		lock.unlock();
+
+		if (!ec)
+			do_read();
+		else
+			ST_THIS on_recv_error(ec);
+	}
+
+	//release the receive buffer if the same waiting (no data arrived) lasts a whole interval.
+	//the timer stops itself after shutdown, in case it was set again by a reading which raced with shutdown().
+	bool release_recv_buffer()
+	{
+		if (is_shutting_down())
+			return false;
+
+		boost::unique_lock<boost::mutex> lock(recv_wait_mutex);
+		if (recv_waiting && recv_wait_num == checked_wait_num)
+			unpacker_->release_buffer();
+		checked_wait_num = recv_wait_num;
+
+		return true;
+	}
+#endif
+
 	void send_handler(const boost::system::error_code& ec, size_t bytes_transferred)
 	{
 		if (!ec)
@@ -242,15 +375,24 @@ private:
 			ST_THIS stat.send_byte_sum += bytes_transferred;
 			ST_THIS stat.send_msg_sum += last_send_msg.size();
 #ifdef ST_ASIO_WANT_MSG_SEND_NOTIFY
+			last_send_msg.front().materialize(); //a shared (broadcast) msg must be copied before been handed over as a mutable one
 			ST_THIS on_msg_send(last_send_msg.front());
+#elif defined(ST_ASIO_WANT_BATCH_MSG_SEND_NOTIFY)
+			for (auto& item : last_send_msg)
+				item.materialize();
+			on_msgs_send(last_send_msg);
 #endif
 #ifdef ST_ASIO_WANT_ALL_MSG_SEND_NOTIFY
 			if (ST_THIS send_msg_buffer.empty())
+			{
+				last_send_msg.back().materialize();
 				ST_THIS on_all_msg_send(last_send_msg.back());
+			}
 #endif
 		}
 		else
 			ST_THIS on_send_error(ec);
+		send_bufs.clear(); //keep the memory for reusing
 		last_send_msg.clear();
 
 		if (ec)
@@ -261,14 +403,22 @@ private:
 			if (!ST_THIS send_msg_buffer.empty())
 				ST_THIS send_msg(); //just make sure no pending msgs
 		}
+		ST_THIS check_send_buffer();
 	}
 
 protected:
-	boost::container::list<typename super::in_msg> last_send_msg;
+	sent_container_type last_send_msg; //use the same container as the sending buffer, ring_buffer keeps its memory after clear()
+	std::vector<boost::asio::const_buffer> send_bufs; //reused by every async_write, so gathering msgs will not allocate memory in steady state
+	size_t max_send_size_, max_send_num_;
 	boost::shared_ptr<i_unpacker<out_msg_type>> unpacker_;
 
 	shutdown_states shutdown_state;
 	st_atomic_size_t shutdown_atomic;
+
+	boost::mutex recv_wait_mutex; //protects the receive buffer against release_recv_buffer() while waiting for data
+	bool recv_waiting;
+	size_t recv_wait_num, checked_wait_num;
+	bool release_timer_set;
 };
 
 } //namespace
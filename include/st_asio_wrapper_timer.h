@@ -15,6 +15,8 @@
 
 #include <vector>
 
+#include <boost/container/list.hpp>
+
 #ifdef ST_ASIO_USE_STEADY_TIMER
 #include <boost/asio/steady_timer.hpp>
 #elif defined(ST_ASIO_USE_SYSTEM_TIMER)
@@ -23,10 +25,245 @@
 
 #include "st_asio_wrapper_object.h"
 
+//if defined, all st_timer on the same io_service share one hashed timing wheel (an io_service service), which is driven by one system timer,
+//starting and stopping a timer are O(1) and need no heap allocations, and timers are rounded up to ST_ASIO_TIMING_WHEEL_TICK milliseconds.
+//if not defined, every timer in every st_timer owns an asio timer (see st_timer::timer_type).
+//#define ST_ASIO_USE_TIMING_WHEEL
+#ifdef ST_ASIO_USE_TIMING_WHEEL
+#ifndef ST_ASIO_TIMING_WHEEL_TICK
+#define ST_ASIO_TIMING_WHEEL_TICK		10 //milliseconds, precision of all timers
+#endif
+static_assert(ST_ASIO_TIMING_WHEEL_TICK > 0, "timing wheel tick must be bigger than zero.");
+
+#ifndef ST_ASIO_TIMING_WHEEL_SLOT_NUM
+#define ST_ASIO_TIMING_WHEEL_SLOT_NUM	512 //timers longer than ST_ASIO_TIMING_WHEEL_TICK * ST_ASIO_TIMING_WHEEL_SLOT_NUM milliseconds will stay in the wheel for more rounds
+#endif
+static_assert(ST_ASIO_TIMING_WHEEL_SLOT_NUM > 0, "timing wheel slot number must be bigger than zero.");
+#endif
+
 //If you inherit a class from class X, your own timer ids must begin from X::TIMER_END
 namespace st_asio_wrapper
 {
 
+#ifdef ST_ASIO_USE_TIMING_WHEEL
+//a hashed timing wheel, one per io_service (get it via boost::asio::use_service), timers are linked into slots intrusively (see node),
+//every tick, the wheel moves to the next slot, and all timers in it whose rounds reached zero will expire, each expired timer will be moved to
+//the ready list and one handler will be posted to the io_service for it, so expired timers' on_expire are called concurrently by service threads.
+//thread safe.
+template<typename Timer, typename Milliseconds>
+class st_timing_wheel : public boost::asio::io_service::service
+{
+public:
+	static boost::asio::io_service::id id;
+
+	struct node
+	{
+		static const size_t IDLE = (size_t) -1, READY = (size_t) -2; //special values of slot, READY means expired and waiting for on_expire in the ready list
+
+		node() : prev(nullptr), next(nullptr), slot(IDLE), rounds(0), running(0), owner(nullptr), on_expire(nullptr) {}
+		bool is_armed() const {return IDLE != slot;}
+
+		node* prev;
+		node* next;
+		size_t slot;
+		size_t rounds;
+		size_t running; //how many on_expire of this node are being called
+
+		void* owner;
+		void (*on_expire)(void* owner, node& n); //called without any locks
+		boost::shared_ptr<void> guard; //hold by the wheel until the timer been stopped or on_expire returned
+	};
+
+	st_timing_wheel(boost::asio::io_service& io_service__) : boost::asio::io_service::service(io_service__), io_service_(io_service__),
+		timer(io_service__), slots(ST_ASIO_TIMING_WHEEL_SLOT_NUM, nullptr), ready_head(nullptr), ready_tail(nullptr), cur_slot(0), armed_num(0), started(false) {}
+
+	virtual void shutdown_service()
+	{
+		boost::unique_lock<boost::mutex> lock(wheel_mutex);
+		for (auto iter = std::begin(slots); iter != std::end(slots); ++iter)
+			while (nullptr != *iter)
+				unlink(**iter);
+		while (nullptr != ready_head)
+			unlink(*ready_head);
+
+		started = false;
+		boost::system::error_code ec;
+		timer.cancel(ec);
+	}
+
+	//if n is already armed, it will be rearmed.
+	void arm(node& n, size_t milliseconds, const boost::shared_ptr<void>& guard = boost::shared_ptr<void>())
+	{
+		size_t ticks = (milliseconds + ST_ASIO_TIMING_WHEEL_TICK - 1) / ST_ASIO_TIMING_WHEEL_TICK;
+		if (0 == ticks)
+			ticks = 1;
+
+		boost::unique_lock<boost::mutex> lock(wheel_mutex);
+		if (n.is_armed())
+			unlink(n);
+		link(n, (cur_slot + ticks) % ST_ASIO_TIMING_WHEEL_SLOT_NUM, (ticks - 1) / ST_ASIO_TIMING_WHEEL_SLOT_NUM);
+		n.guard = guard;
+
+		if (!started)
+		{
+			started = true;
+			timer.expires_from_now(Milliseconds(ST_ASIO_TIMING_WHEEL_TICK));
+			timer.async_wait([this](const boost::system::error_code& ec) {ST_THIS tick(ec);});
+		}
+	}
+
+	//if n already expired but on_expire has not been called yet, on_expire will not be called any more,
+	//but if on_expire is being called, it will not be interrupted (use detach to wait for it).
+	void cancel(node& n)
+	{
+		boost::shared_ptr<void> guard; //release the guard after unlocking
+		boost::unique_lock<boost::mutex> lock(wheel_mutex);
+		if (n.is_armed())
+		{
+			unlink(n);
+			guard.swap(n.guard);
+		}
+	}
+
+	//cancel n and wait until all of its on_expire returned, after that, the wheel will never reach n again, so n can be destroyed.
+	//must not be called in n's own on_expire, or dead lock will occur.
+	void detach(node& n)
+	{
+		boost::unique_lock<boost::mutex> lock(wheel_mutex);
+		while (true)
+			if (n.is_armed()) //a running on_expire may rearm n, so check it after every waiting
+			{
+				unlink(n);
+				boost::shared_ptr<void> guard;
+				guard.swap(n.guard);
+				lock.unlock();
+				guard.reset(); //release the guard without locking
+				lock.lock();
+			}
+			else if (n.running > 0)
+				wheel_cond.wait(lock);
+			else
+				break;
+	}
+
+private:
+	void link(node& n, size_t slot, size_t rounds)
+	{
+		n.slot = slot;
+		n.rounds = rounds;
+		n.prev = nullptr;
+		n.next = slots[slot];
+		if (nullptr != n.next)
+			n.next->prev = &n;
+		slots[slot] = &n;
+		++armed_num;
+	}
+
+	//append n to the ready list, n must not be armed.
+	void link_ready(node& n)
+	{
+		n.slot = node::READY;
+		n.prev = ready_tail;
+		n.next = nullptr;
+		if (nullptr != ready_tail)
+			ready_tail->next = &n;
+		else
+			ready_head = &n;
+		ready_tail = &n;
+	}
+
+	//remove n from a slot or the ready list.
+	void unlink(node& n)
+	{
+		auto ready = node::READY == n.slot;
+		if (nullptr != n.prev)
+			n.prev->next = n.next;
+		else if (ready)
+			ready_head = n.next;
+		else
+			slots[n.slot] = n.next;
+		if (nullptr != n.next)
+			n.next->prev = n.prev;
+		else if (ready)
+			ready_tail = n.prev;
+
+		n.prev = n.next = nullptr;
+		n.slot = node::IDLE;
+		if (!ready)
+			--armed_num;
+	}
+
+	void tick(const boost::system::error_code& ec)
+	{
+		if (ec) //shutdown
+			return;
+
+		size_t expired_num = 0;
+		boost::unique_lock<boost::mutex> lock(wheel_mutex);
+		cur_slot = (cur_slot + 1) % ST_ASIO_TIMING_WHEEL_SLOT_NUM;
+		for (auto n = slots[cur_slot]; nullptr != n;)
+		{
+			auto next = n->next;
+			if (0 == n->rounds)
+			{
+				unlink(*n);
+				link_ready(*n); //keep the guard until on_expire returned
+				++expired_num;
+			}
+			else
+				--n->rounds;
+			n = next;
+		}
+
+		if (armed_num > 0) //stop ticking if no timers, arm will restart it
+		{
+			timer.expires_at(timer.expires_at() + Milliseconds(ST_ASIO_TIMING_WHEEL_TICK)); //no drift, if we're late, the next tick will come immediately
+			timer.async_wait([this](const boost::system::error_code& ec) {ST_THIS tick(ec);});
+		}
+		else
+			started = false;
+		lock.unlock();
+
+		//handlers don't refer to nodes, each of them just takes the first node in the ready list (if any), so cancelled nodes will not be reached.
+		while (expired_num-- > 0)
+			io_service_.post([this]() {ST_THIS dispatch();});
+	}
+
+	void dispatch()
+	{
+		boost::shared_ptr<void> guard; //release the guard after unlocking
+		boost::unique_lock<boost::mutex> lock(wheel_mutex);
+		auto n = ready_head;
+		if (nullptr == n) //been cancelled
+			return;
+
+		unlink(*n);
+		guard.swap(n->guard);
+		++n->running;
+		lock.unlock();
+
+		n->on_expire(n->owner, *n);
+
+		lock.lock();
+		--n->running; //don't touch n after this, it can be destroyed as soon as detach returned
+		lock.unlock();
+		wheel_cond.notify_all();
+	}
+
+private:
+	boost::asio::io_service& io_service_;
+	Timer timer;
+	std::vector<node*> slots;
+	node* ready_head;
+	node* ready_tail;
+	size_t cur_slot, armed_num;
+	bool started;
+	boost::mutex wheel_mutex;
+	boost::condition_variable wheel_cond;
+};
+template<typename Timer, typename Milliseconds> boost::asio::io_service::id st_timing_wheel<Timer, Milliseconds>::id;
+#endif
+
 //timers are identified by id.
 //for the same timer in the same st_timer, any manipulations are not thread safe, please pay special attention.
 //to resolve this defect, we must add a mutex member variable to timer_info, it's not worth
@@ -58,7 +295,13 @@ public:
 	typedef unsigned char tid;
 	static const tid TIMER_END = 0; //user timer's id must begin from parent class' TIMER_END
 
+#ifdef ST_ASIO_USE_TIMING_WHEEL
+	typedef st_timing_wheel<timer_type, milliseconds> timing_wheel;
+
+	struct timer_info : public timing_wheel::node
+#else
 	struct timer_info
+#endif
 	{
 		enum timer_status {TIMER_FAKE, TIMER_OK, TIMER_CANCELED};
 
@@ -66,22 +309,33 @@ public:
 		timer_status status;
 		size_t milliseconds;
 		std::function<bool(tid)> call_back;
+#ifndef ST_ASIO_USE_TIMING_WHEEL
 		boost::shared_ptr<timer_type> timer;
+#endif
 
 		timer_info() : id(0), status(TIMER_FAKE), milliseconds(0) {}
 	};
 
 	typedef const timer_info timer_cinfo;
-	typedef std::vector<timer_info> container_type;
+	//only timers ever been set are stored (sorted by id), an object generally uses just a few timers,
+	//a list (rather than a vector) keeps timer_info's address unchanged, because asio handlers and the timing wheel refer to it.
+	typedef boost::container::list<timer_info> container_type;
 
-	st_timer(boost::asio::io_service& _io_service_) : st_object(_io_service_), timer_can(256) {tid id = -1; do_something_to_all([&id](timer_info& item) {item.id = ++id;});}
+#ifdef ST_ASIO_USE_TIMING_WHEEL
+	st_timer(boost::asio::io_service& _io_service_) : st_object(_io_service_), wheel(boost::asio::use_service<timing_wheel>(_io_service_)) {}
+	~st_timer() {do_something_to_all([this](timer_info& item) {ST_THIS wheel.detach(item);});} //the wheel must not reach us any more
+#else
+	st_timer(boost::asio::io_service& _io_service_) : st_object(_io_service_) {}
+#endif
 
 	void update_timer_info(tid id, size_t milliseconds, std::function<bool(tid)>&& call_back, bool start = false)
 	{
-		timer_info& ti = timer_can[id];
+		timer_info& ti = get_timer_info(id);
 
+#ifndef ST_ASIO_USE_TIMING_WHEEL
 		if (timer_info::TIMER_FAKE == ti.status)
 			ti.timer = boost::make_shared<timer_type>(io_service_);
+#endif
 		ti.status = timer_info::TIMER_OK;
 		ti.milliseconds = milliseconds;
 		ti.call_back.swap(call_back);
@@ -95,30 +349,132 @@ public:
 	void set_timer(tid id, size_t milliseconds, std::function<bool(tid)>&& call_back) {update_timer_info(id, milliseconds, std::move(call_back), true);}
 	void set_timer(tid id, size_t milliseconds, const std::function<bool(tid)>& call_back) {update_timer_info(id, milliseconds, call_back, true);}
 
-	timer_info find_timer(tid id) const {return timer_can[id];}
+	//only timer_info's own fields are copied, the timing wheel's part (see st_timing_wheel::node) is protected by the wheel's mutex.
+	timer_info find_timer(tid id) const
+	{
+		timer_info ti_copy;
+		ti_copy.id = id;
+
+		auto ti = find_timer_info(id);
+		if (nullptr != ti)
+		{
+			ti_copy.status = ti->status;
+			ti_copy.milliseconds = ti->milliseconds;
+			ti_copy.call_back = ti->call_back;
+#ifndef ST_ASIO_USE_TIMING_WHEEL
+			ti_copy.timer = ti->timer;
+#endif
+		}
+
+		return ti_copy;
+	}
 
 	bool start_timer(tid id)
 	{
-		timer_info& ti = timer_can[id];
-
-		if (timer_info::TIMER_FAKE == ti.status)
+		auto ti_ptr = find_timer_info(id);
+		if (nullptr == ti_ptr || timer_info::TIMER_FAKE == ti_ptr->status)
 			return false;
 
+		timer_info& ti = *ti_ptr;
+
 		ti.status = timer_info::TIMER_OK;
 		start_timer(ti); //if timer already started, this will cancel it first
 
 		return true;
 	}
 
-	void stop_timer(tid id) {stop_timer(timer_can[id]);}
+	void stop_timer(tid id) {auto ti = find_timer_info(id); if (nullptr != ti) stop_timer(*ti);}
 	void stop_all_timer() {do_something_to_all([this](timer_info& item) {ST_THIS stop_timer(item);});}
 
-	DO_SOMETHING_TO_ALL(timer_can)
-	DO_SOMETHING_TO_ONE(timer_can)
+	//__pred will be called without holding timer_can_mutex (timers will never be erased, so a snapshot of their addresses is enough),
+	//so __pred can set, start and stop timers freely, but timers created during the iteration will not be visited.
+	template<typename _Predicate> void do_something_to_all(const _Predicate& __pred)
+		{auto timers = snapshot(); for (auto iter = std::begin(timers); iter != std::end(timers); ++iter) __pred(**iter);}
+	template<typename _Predicate> void do_something_to_all(const _Predicate& __pred) const
+		{auto timers = snapshot(); for (auto iter = std::begin(timers); iter != std::end(timers); ++iter) __pred(static_cast<timer_cinfo&>(**iter));}
+
+	template<typename _Predicate> void do_something_to_one(const _Predicate& __pred)
+		{auto timers = snapshot(); for (auto iter = std::begin(timers); iter != std::end(timers); ++iter) if (__pred(**iter)) break;}
+	template<typename _Predicate> void do_something_to_one(const _Predicate& __pred) const
+		{auto timers = snapshot(); for (auto iter = std::begin(timers); iter != std::end(timers); ++iter) if (__pred(static_cast<timer_cinfo&>(**iter))) break;}
 
 protected:
 	void reset() {st_object::reset();}
 
+	timer_info* find_timer_info(tid id) {return const_cast<timer_info*>(static_cast<const st_timer*>(this)->find_timer_info(id));}
+	timer_cinfo* find_timer_info(tid id) const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(timer_can_mutex);
+		for (auto iter = std::begin(timer_can); iter != std::end(timer_can) && iter->id <= id; ++iter)
+			if (iter->id == id)
+				return &*iter;
+
+		return nullptr;
+	}
+
+	//addresses of all timers, see do_something_to_all.
+	std::vector<timer_info*> snapshot() const
+	{
+		std::vector<timer_info*> timers;
+		boost::shared_lock<boost::shared_mutex> lock(timer_can_mutex);
+		timers.reserve(timer_can.size());
+		for (auto iter = std::begin(timer_can); iter != std::end(timer_can); ++iter)
+			timers.push_back(const_cast<timer_info*>(&*iter));
+
+		return timers;
+	}
+
+	//find the timer, or create it if not exist.
+	timer_info& get_timer_info(tid id)
+	{
+		auto ti = find_timer_info(id);
+		if (nullptr != ti)
+			return *ti;
+
+		boost::unique_lock<boost::shared_mutex> lock(timer_can_mutex);
+		auto iter = std::begin(timer_can);
+		for (; iter != std::end(timer_can) && iter->id < id; ++iter);
+		if (iter == std::end(timer_can) || iter->id != id) //double check, another thread may created it
+		{
+			iter = timer_can.emplace(iter);
+			iter->id = id;
+#ifdef ST_ASIO_USE_TIMING_WHEEL
+			iter->owner = this;
+			iter->on_expire = &st_timer::on_expire;
+#endif
+		}
+
+		return *iter;
+	}
+
+#ifdef ST_ASIO_USE_TIMING_WHEEL
+	void start_timer(timer_info& ti)
+	{
+		assert(timer_info::TIMER_OK == ti.status);
+#if 0 == ST_ASIO_DELAY_CLOSE
+		wheel.arm(ti, ti.milliseconds, async_call_indicator); //count the timer as an async call
+#else
+		wheel.arm(ti, ti.milliseconds);
+#endif
+	}
+
+	void stop_timer(timer_info& ti)
+	{
+		if (timer_info::TIMER_OK == ti.status) //enable stopping timers that has been stopped
+		{
+			wheel.cancel(ti);
+			ti.status = timer_info::TIMER_CANCELED;
+		}
+	}
+
+	//return true from call_back to continue the timer, or the timer will stop
+	static void on_expire(void* owner, typename timing_wheel::node& n)
+	{
+		auto& ti = static_cast<timer_info&>(n);
+		if (timer_info::TIMER_OK == ti.status && ti.call_back(ti.id) && timer_info::TIMER_OK == ti.status)
+			static_cast<st_timer*>(owner)->start_timer(ti);
+	}
+#else
 	void start_timer(timer_cinfo& ti)
 	{
 		assert(timer_info::TIMER_OK == ti.status);
@@ -138,8 +494,13 @@ protected:
 			ti.status = timer_info::TIMER_CANCELED;
 		}
 	}
+#endif
 
+#ifdef ST_ASIO_USE_TIMING_WHEEL
+	timing_wheel& wheel;
+#endif
 	container_type timer_can;
+	mutable boost::shared_mutex timer_can_mutex; //only protect the structure of timer_can, see the comments before class st_timer for thread safety of timers
 
 private:
 	using st_object::io_service_;
@@ -109,6 +109,9 @@ public:
 	//success at here just means put the msg into st_udp_socket's send buffer
 	UDP_SAFE_SEND_MSG(safe_send_msg, send_msg)
 	UDP_SAFE_SEND_MSG(safe_send_native_msg, send_native_msg)
+	//never block, can be used in service threads
+	UDP_ASYNC_SEND_MSG(async_send_msg, false)
+	UDP_ASYNC_SEND_MSG(async_send_native_msg, true)
 	//msg sending interface
 	///////////////////////////////////////////////////
 
@@ -214,6 +217,9 @@ private:
 			ST_THIS stat.send_time_sum += statistic::local_time() - last_send_msg.begin_time;
 			ST_THIS stat.send_byte_sum += bytes_transferred;
 			++ST_THIS stat.send_msg_sum;
+#if defined(ST_ASIO_WANT_MSG_SEND_NOTIFY) || defined(ST_ASIO_WANT_ALL_MSG_SEND_NOTIFY)
+			last_send_msg.materialize();
+#endif
 #ifdef ST_ASIO_WANT_MSG_SEND_NOTIFY
 			ST_THIS on_msg_send(last_send_msg);
 #endif
@@ -235,6 +241,7 @@ private:
 			if (!ST_THIS send_msg_buffer.empty())
 				ST_THIS send_msg(); //just make sure no pending msgs
 		}
+		ST_THIS check_send_buffer();
 	}
 
 protected:
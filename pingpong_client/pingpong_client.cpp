@@ -9,6 +9,7 @@
 #define ST_ASIO_DELAY_CLOSE		5 //define this to avoid hooks for async call (and slightly improve efficiency)
 //#define ST_ASIO_FORCE_TO_USE_MSG_RECV_BUFFER
 //#define ST_ASIO_WANT_MSG_SEND_NOTIFY
+//#define ST_ASIO_WANT_BATCH_MSG_SEND_NOTIFY //like ST_ASIO_WANT_MSG_SEND_NOTIFY, but doesn't disable msg batching
 #define ST_ASIO_MSG_BUFFER_SIZE	65536
 #define ST_ASIO_INPUT_QUEUE non_lock_queue //we will never operate sending buffer concurrently, so need no locks.
 #define ST_ASIO_DEFAULT_UNPACKER stream_unpacker //non-protocol
@@ -46,7 +47,7 @@ st_atomic<unsigned short> completed_session_num;
 //2. for sender, if responses are available (like pingpong test), send msgs in on_msg()/on_msg_handle().
 //    this will reduce IO throughput because, SOCKET's sliding window is not fully used, pleae note.
 //
-//pingpong_client will choose method #1 if defined ST_ASIO_WANT_MSG_SEND_NOTIFY, otherwise #2
+//pingpong_client will choose method #1 if defined ST_ASIO_WANT_MSG_SEND_NOTIFY or ST_ASIO_WANT_BATCH_MSG_SEND_NOTIFY, otherwise #2
 //BTW, if pingpong_client chose method #2, then pingpong_server can work properly without any congestion control,
 //which means pingpong_server can send msgs back with can_overflow parameter equal to true, and memory occupation
 //will be under control.
@@ -82,7 +83,23 @@ protected:
 		if (send_bytes < total_bytes)
 			direct_send_msg(std::move(msg), true);
 	}
+#elif defined(ST_ASIO_WANT_BATCH_MSG_SEND_NOTIFY)
+	//congestion control, method #1, the peer needs its own congestion control too.
+	//one callback per async_write, all msgs sent by it are in msg_can.
+	virtual void on_msgs_send(sent_container_type& msg_can)
+	{
+		for (auto iter = std::begin(msg_can); iter != std::end(msg_can); ++iter)
+		{
+			send_bytes += iter->size();
+			if (send_bytes >= total_bytes)
+				break;
+
+			direct_send_msg(std::move(*iter), true);
+		}
+	}
+#endif
 
+#if defined(ST_ASIO_WANT_MSG_SEND_NOTIFY) || defined(ST_ASIO_WANT_BATCH_MSG_SEND_NOTIFY)
 private:
 	void handle_msg(out_msg_ctype& msg)
 	{
@@ -16,6 +16,7 @@
 //if pingpong_client send message in on_msg_send(), then using non_lock_queue as input queue in pingpong_server will lead
 //undefined behavior, please note.
 #define ST_ASIO_DEFAULT_UNPACKER stream_unpacker //non-protocol
+//#define MULTI_SERVICE_PUMP //one io_service per service thread, accepted links are distributed to them
 //configuration
 
 #include "../include/ext/st_asio_wrapper_server.h"
@@ -111,7 +112,15 @@ int main(int argc, const char* argv[])
 	else
 		puts("type " QUIT_COMMAND " to end.");
 
+	auto thread_num = 1;
+	if (argc > 1)
+		thread_num = std::min(16, std::max(thread_num, atoi(argv[1])));
+
+#ifdef MULTI_SERVICE_PUMP
+	st_multi_service_pump sp(thread_num);
+#else
 	st_service_pump sp;
+#endif
 	echo_server echo_server_(sp);
 
 	if (argc > 3)
@@ -119,11 +128,11 @@ int main(int argc, const char* argv[])
 	else if (argc > 2)
 		echo_server_.set_server_addr(atoi(argv[2]));
 
-	auto thread_num = 1;
-	if (argc > 1)
-		thread_num = std::min(16, std::max(thread_num, atoi(argv[1])));
-
+#ifdef MULTI_SERVICE_PUMP
+	sp.start_service(1); //the first io_service (acceptor and timers) only needs one thread
+#else
 	sp.start_service(thread_num);
+#endif
 	while(sp.is_running())
 	{
 		std::string str;
@@ -0,0 +1,73 @@
+
+#include <iostream>
+#include <boost/timer/timer.hpp>
+
+//configuration
+#define ST_ASIO_FULL_STATISTIC
+//#define ST_ASIO_STAT_HISTOGRAM
+//#define ST_ASIO_STAT_CLOCK_ID CLOCK_MONOTONIC //default clock is CLOCK_MONOTONIC_COARSE (or CLOCK_MONOTONIC if ST_ASIO_STAT_HISTOGRAM defined)
+//configuration
+
+#include "../include/st_asio_wrapper_base.h"
+using namespace st_asio_wrapper;
+
+#ifdef _MSC_VER
+#define atoll _atoi64
+#endif
+
+//measure the overhead of full statistic per message, st_asio_wrapper gathers statistic like this:
+//sending: obj_with_begin_time::restart (in send_msg), send delay (before async_write), send duration (in send_handler)
+//receiving: unpack duration (in recv_handler, via auto_duration), obj_with_begin_time::restart (after parse_msg), on_msg duration,
+// dispatch delay and on_msg_handle duration (in msg_handler)
+//so there're about 8 clock readings per message (one send and one receive).
+
+struct dummy_msg {void swap(dummy_msg&) {}};
+
+template<typename F>
+double ns_per_op(size_t loop_num, const F& f)
+{
+	boost::timer::cpu_timer begin_time;
+	for (size_t i = 0; i < loop_num; ++i)
+		f();
+	return (double) begin_time.elapsed().wall / loop_num;
+}
+
+int main(int argc, const char* argv[])
+{
+	puts("usage: stat_benchmark [<loop number=10000000>]");
+
+	size_t loop_num = 10000000;
+	if (argc > 1)
+		loop_num = std::max((size_t) atoll(argv[1]), (size_t) 1);
+
+	volatile int_fast64_t sink = 0; //prevent the compiler from optimizing the clock readings away
+	printf("boost::posix_time microsec_clock (the old clock): %f ns per reading.\n",
+		ns_per_op(loop_num, [&]() {sink = sink + boost::date_time::microsec_clock<boost::posix_time::ptime>::local_time().time_of_day().ticks();}));
+	printf("ST_ASIO_STAT_CLOCK: %f ns per reading.\n", ns_per_op(loop_num, [&]() {sink = sink + statistic::local_time();}));
+
+	statistic stat;
+	obj_with_begin_time<dummy_msg> msg;
+	printf("full statistic: %f ns per message (send and receive).\n", ns_per_op(loop_num, [&]() {
+		//sending
+		msg.restart();
+		stat.send_delay_sum += statistic::local_time() - msg.begin_time;
+		stat.send_time_sum += statistic::local_time() - msg.begin_time;
+		++stat.send_msg_sum;
+
+		//receiving
+		{
+			auto_duration dur(stat.unpack_time_sum);
+		}
+		msg.restart();
+		{
+			auto_duration dur(stat.handle_time_1_sum);
+		}
+		auto begin_time = statistic::local_time();
+		stat.dispatch_dealy_sum += begin_time - msg.begin_time;
+		stat.handle_time_2_sum += statistic::local_time() - begin_time;
+		++stat.recv_msg_sum;
+	}));
+
+	puts(stat.to_string().data());
+	return 0;
+}
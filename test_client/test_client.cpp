@@ -11,6 +11,8 @@
 //#define ST_ASIO_CLEAR_OBJECT_INTERVAL 1
 //#define ST_ASIO_WANT_MSG_SEND_NOTIFY
 #define ST_ASIO_FULL_STATISTIC //full statistic will slightly impact efficiency
+//#define ST_ASIO_INPUT_CONTAINER ring_buffer //no memory allocation on sending buffer in steady state
+//#define ALLOCATION_STATISTIC //count memory allocations (replace global operator new), the benchmark command needs it
 #ifdef ST_ASIO_WANT_MSG_SEND_NOTIFY
 #define ST_ASIO_INPUT_QUEUE non_lock_queue //we will never operate sending buffer concurrently, so need no locks.
 #endif
@@ -22,6 +24,7 @@
 //1-default replaceable_packer and replaceable_unpacker, head(length) + body
 //2-fixed length unpacker
 //3-prefix and suffix packer and unpacker
+//4-slab_packer and slab_unpacker, head(length) + body, packing and unpacking msgs without memory allocation and replication
 
 #if 1 == PACKER_UNPACKER_TYPE
 #define ST_ASIO_DEFAULT_PACKER replaceable_packer<>
@@ -32,6 +35,9 @@
 #elif 3 == PACKER_UNPACKER_TYPE
 #define ST_ASIO_DEFAULT_PACKER prefix_suffix_packer
 #define ST_ASIO_DEFAULT_UNPACKER prefix_suffix_unpacker
+#elif 4 == PACKER_UNPACKER_TYPE
+#define ST_ASIO_DEFAULT_PACKER slab_packer
+#define ST_ASIO_DEFAULT_UNPACKER slab_unpacker
 #endif
 
 #include "../include/ext/st_asio_wrapper_client.h"
@@ -48,9 +54,16 @@ using namespace st_asio_wrapper::ext;
 #define LIST_STATUS		"status"
 #define SUSPEND_COMMAND	"suspend"
 #define RESUME_COMMAND	"resume"
+#define BENCHMARK_COMMAND	"benchmark"
 
 static bool check_msg;
 
+#ifdef ALLOCATION_STATISTIC
+st_atomic_uint_fast64 allocation_num;
+void* operator new(size_t size) {++allocation_num; auto p = malloc(size); if (nullptr == p) throw std::bad_alloc(); return p;}
+void operator delete(void* p) throw() {free(p);}
+#endif
+
 //about congestion control
 //
 //in 1.3, congestion control has been removed (no post_msg nor post_native_msg anymore), this is because
@@ -358,6 +371,45 @@ void send_msg_concurrently(test_client& client, size_t msg_num, size_t msg_len,
 	threads.join_all();
 }
 
+//simulate the sending path of st_tcp_socket (send_msg_buffer -> last_send_msg) without network IO,
+//messages are recycled, so the memory allocations counted at here are all caused by the containers.
+template<template<typename> class Container>
+void container_benchmark(const char* name, size_t msg_num, size_t msg_len)
+{
+	typedef obj_with_begin_time<std::string> msg_type;
+	const size_t batch_num = 64; //messages per async_write
+
+	lock_queue<msg_type, Container<msg_type>> send_msg_buffer;
+	Container<msg_type> last_send_msg;
+	std::vector<std::string> msg_pool(batch_num, std::string(msg_len, '0'));
+
+#ifdef ALLOCATION_STATISTIC
+	uint_fast64_t begin_allocation_num = allocation_num;
+#endif
+	boost::timer::cpu_timer begin_time;
+	for (size_t i = 0; i < msg_num; i += batch_num)
+	{
+		do_something_to_all(msg_pool, [&send_msg_buffer](std::string& item) {send_msg_buffer.enqueue(msg_type(std::move(item)));});
+
+		msg_type msg;
+		typename decltype(send_msg_buffer)::lock_guard lock(send_msg_buffer);
+		while (send_msg_buffer.try_dequeue_(msg))
+			last_send_msg.push_back(std::move(msg));
+
+		auto iter = std::begin(msg_pool);
+		do_something_to_all(last_send_msg, [&iter](msg_type& item) {iter++->swap(item);});
+		last_send_msg.clear();
+	}
+	begin_time.stop();
+
+	auto used_time = (double) begin_time.elapsed().wall / 1000000000;
+#ifdef ALLOCATION_STATISTIC
+	printf("%s: %f seconds, %.3f allocation(s) per msg.\n", name, used_time, (double) (allocation_num - begin_allocation_num) / msg_num);
+#else
+	printf("%s: %f seconds (define ALLOCATION_STATISTIC to count memory allocations).\n", name, used_time);
+#endif
+}
+
 int main(int argc, const char* argv[])
 {
 	printf("usage: %s [<service thread number=1> [<port=%d> [<ip=%s> [link num=16]]]]\n", argv[0], ST_ASIO_SERVER_PORT, ST_ASIO_SERVER_IP);
@@ -436,6 +488,11 @@ int main(int argc, const char* argv[])
 			client.do_something_to_all([](test_client::object_ctype& item) {item->suspend_dispatch_msg(false);});
 		else if (LIST_ALL_CLIENT == str)
 			client.list_all_object();
+		else if (BENCHMARK_COMMAND == str)
+		{
+			container_benchmark<list>("list", 1024 * 1024, 1024);
+			container_benchmark<ring_buffer>("ring_buffer", 1024 * 1024, 1024);
+		}
 		else if (!str.empty())
 		{
 			if ('+' == str[0] || '-' == str[0])
@@ -476,7 +533,7 @@ int main(int argc, const char* argv[])
 			auto iter = std::begin(tok);
 			if (iter != std::end(tok)) msg_num = std::max((size_t) atoll(iter++->data()), (size_t) 1);
 
-#if 0 == PACKER_UNPACKER_TYPE || 1 == PACKER_UNPACKER_TYPE
+#if 0 == PACKER_UNPACKER_TYPE || 1 == PACKER_UNPACKER_TYPE || 4 == PACKER_UNPACKER_TYPE
 			if (iter != std::end(tok)) msg_len = std::min(packer::get_max_msg_size(),
 				std::max((size_t) atoi(iter++->data()), sizeof(size_t))); //include seq
 #elif 2 == PACKER_UNPACKER_TYPE